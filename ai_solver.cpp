@@ -1,95 +1,448 @@
 #include "ai_solver.h"
+#include "symmetry.h"
 #include <iostream>
-#include <queue>
 #include <thread>
-#include <future>
 #include <algorithm>
+#include <climits>
 #include <memory> // [MODIFIED] Include for std::unique_ptr
+#include <unordered_set>
 
 using namespace std;
 
-// AISolver ʵ
+// Nodes expanded by search_task on this thread, and how many of them were added to nodes_searched
+static thread_local long long nodes_on_thread = 0;
+static thread_local long long nodes_reported = 0;
+// Nodes this thread expands before its next pollSearch
+static thread_local int nodes_to_poll = 0;
+
+// open_node results of a node whose children are to be searched, and of a search that is over
+static const int EXPANDED = -2;
+static const int ABORTED = -3;
+
+thread_local AISolver::ThreadCounters* AISolver::thread_stats = nullptr;
+
+// Single-writer counters: a relaxed load and store, no locked read-modify-write
+static inline void bump(atomic<long long>& counter) {
+    counter.store(counter.load(memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+// Maps every move of a path through one symmetry of its geometry
+static vector<MoveIndex> transformPath(const SymmetryGroup& symmetries, const vector<MoveIndex>& path, int transform) {
+    vector<MoveIndex> result;
+    result.reserve(path.size());
+    for (MoveIndex move : path) result.push_back(symmetries.moveImage(transform, move));
+    return result;
+}
+
+
+// AISolver 方法的实现
 AISolver::AISolver(Board* board, int target_pegs)
     : initialBoard(board), max_pegs_to_solve(target_pegs),
-    global_solution_found(false), is_paused(false), timed_out(false),
+    global_solution_found(false), is_paused(false), stop_reason(SearchStop::Finished),
     force_stop(false),
-    best_solution_depth(INT_MAX) {
+    best_solution_depth(INT_MAX), verify_hashes(false), hash_collisions(0),
+    transposition_table(nullptr),
+    dead_positions(nullptr),
+    solution_store(nullptr),
+    log_stream(&cout),
+    thread_count(0), split_depth(2), island_geometry(0), island_byte_count(0), pagoda_pruning(true),
+    search_mode(SearchMode::IterativeDeepening), finish_cell(-1), depth_first(false), move_ordering(board->getMoveOrdering()), move_model(nullptr), nodes_searched(0), layer_bytes(0),
+    running_job(nullptr), jobs_closing(false), statistics_enabled(false), answered_by(nullptr) {
+}
+
+AISolver::~AISolver() {
+    {
+        lock_guard<mutex> lock(job_mutex);
+        jobs_closing = true;
+    }
+    cancelAll();
+    job_cond.notify_all();
+    if (job_thread.joinable()) job_thread.join();
+}
+
+bool SolveJob::isDone() const {
+    return future.wait_for(chrono::seconds(0)) == future_status::ready;
+}
+
+float SolveJob::getProgress() const {
+    int max = progressMax.load();
+    return max > 0 ? (std::min)(1.0f, (float)progress.load() / max) : 0.0f;
+}
+
+void SolveJob::cancel() {
+    cancelled = true;
+    State queued = State::Queued;
+    if (state.compare_exchange_strong(queued, State::Done)) {
+        SolveResult result;
+        result.stop = SearchStop::Stopped;
+        promise.set_value(result);
+    }
+}
+
+shared_ptr<SolveJob> AISolver::solveAsync(const Board& board, const SearchBudget& job_budget) {
+    shared_ptr<SolveJob> job(new SolveJob());
+    job->board = board.clone(false);
+    job->budget = job_budget;
+    job->future = job->promise.get_future().share();
+    lock_guard<mutex> lock(job_mutex);
+    if (!job_thread.joinable()) job_thread = thread(&AISolver::runJobs, this);
+    job_queue.push_back(job);
+    job_cond.notify_one();
+    return job;
+}
+
+void AISolver::cancelAll() {
+    lock_guard<mutex> lock(job_mutex);
+    for (const shared_ptr<SolveJob>& job : job_queue) job->cancel();
+    job_queue.clear();
+    if (SolveJob* job = running_job.load()) job->cancel();
 }
 
-void AISolver::pause() { is_paused = true; cout << "AI search paused." << endl; }
-void AISolver::resume() { is_paused = false; cout << "AI search resumed." << endl; pause_cond.notify_all(); }
+// job_thread: runs queued jobs in turn until the solver is destroyed. checkBudget polls the
+// running job's flags, so cancelling or pausing it needs nothing from this thread.
+void AISolver::runJobs() {
+    while (true) {
+        shared_ptr<SolveJob> job;
+        {
+            unique_lock<mutex> lock(job_mutex);
+            job_cond.wait(lock, [this] { return jobs_closing || !job_queue.empty(); });
+            if (job_queue.empty()) return;
+            job = job_queue.front();
+            job_queue.pop_front();
+            SolveJob::State queued = SolveJob::State::Queued;
+            if (!job->state.compare_exchange_strong(queued, SolveJob::State::Running)) continue; // cancelled
+            running_job = job.get();
+        }
+        SolveJob* running = job.get();
+        SolveResult result;
+        result.moves = findSolution(*job->board, job->budget, [running](int current, int max) {
+            running->progressMax = max;
+            running->progress = current;
+        });
+        result.stop = result.moves.empty() ? stop_reason.load() : SearchStop::Finished;
+        result.nodes = nodes_searched.load();
+        {
+            lock_guard<mutex> lock(job_mutex);
+            running_job = nullptr;
+        }
+        job->state = SolveJob::State::Done;
+        job->promise.set_value(move(result));
+    }
+}
+
+void AISolver::pause() { is_paused = true; logStream() << "AI search paused." << endl; }
+void AISolver::resume() { is_paused = false; logStream() << "AI search resumed." << endl; pause_cond.notify_all(); }
 void AISolver::stop() {
     force_stop = true;
-    cout << "AI search stopping." << endl;
+    logStream() << "AI search stopping." << endl;
     if (is_paused.load()) {
         resume();
     }
 }
+void AISolver::setThreadCount(int threads) { thread_count = threads; }
+void AISolver::setSplitDepth(int depth) { split_depth = (std::max)(0, depth); }
 bool AISolver::isPaused() const { return is_paused.load(); }
-bool AISolver::hasTimedOut() const { return timed_out.load(); }
+bool AISolver::hasTimedOut() const { return stop_reason.load() == SearchStop::TimeLimit; }
+SearchStop AISolver::getStopReason() const { return stop_reason.load(); }
+void AISolver::setHashVerification(bool enabled) {
+    verify_hashes = enabled;
+    if (transposition_table) transposition_table->setVerification(enabled);
+    if (dead_positions) dead_positions->setVerification(enabled);
+}
+long long AISolver::getHashCollisions() const {
+    return hash_collisions.load() + (transposition_table ? transposition_table->getStatistics().collisions : 0) +
+        (dead_positions ? dead_positions->collisions() : 0);
+}
+void AISolver::setTranspositionTable(TranspositionTable& table) {
+    transposition_table = &table;
+    transposition_table->setVerification(verify_hashes);
+}
+TranspositionTable::Statistics AISolver::getTranspositionStatistics() const {
+    return transposition_table ? transposition_table->getStatistics() : TranspositionTable::Statistics();
+}
+void AISolver::setDeadPositionSet(DeadPositionSet& set) {
+    dead_positions = &set;
+    dead_positions->setVerification(verify_hashes);
+}
+void AISolver::setSolutionStore(SolutionStore& store) { solution_store = &store; }
+void AISolver::setLogStream(ostream* stream) { log_stream = stream; }
+long long AISolver::getNodesSearched() const { return nodes_searched.load(); }
+void AISolver::setStatisticsEnabled(bool enabled) { statistics_enabled = enabled; }
+void AISolver::setPagodaPruning(bool enabled) { pagoda_pruning = enabled; }
+void AISolver::setSearchMode(SearchMode mode) { search_mode = mode; }
+void AISolver::setMoveOrdering(const MoveOrdering& ordering) { move_ordering = ordering; }
+void AISolver::setMoveModel(const MoveModel* model) { move_model = model; }
+void AISolver::setFinishHole(int x, int y) { finish_cell = initialBoard->getGeometry().getCellIndex(x, y); }
+
+AISolver::ThreadCounters* AISolver::countersOfThisThread() {
+    if (!statistics_enabled || thread_counters.empty()) return nullptr;
+    int index = pool ? pool->currentWorkerIndex() : -1;
+    // Slots are allocated before the search starts; the last one belongs to the calling thread
+    return thread_counters[index >= 0 ? index : thread_counters.size() - 1].get();
+}
 
-int AISolver::calculateHeuristic(const Board* board) {
-    int islands = 0;
-    vector<vector<bool>> visited(board->getHeight(), vector<bool>(board->getWidth(), false));
-    for (int y = 0; y < board->getHeight(); ++y) {
-        for (int x = 0; x < board->getWidth(); ++x) {
-            if (board->getPeg(x, y) == 1 && !visited[y][x]) {
-                islands++;
-                queue<Position> q;
-                q.push({ x, y });
-                visited[y][x] = true;
-                while (!q.empty()) {
-                    Position current = q.front(); q.pop();
-                    int dx[] = { -1, 1, 0, 0, -1, -1, 1, 1, -2, 2, 0, 0, -2, -2, 2, 2 };
-                    int dy[] = { 0, 0, -1, 1, -1, 1, -1, 1,  0, 0, -2, 2, -2, 2, -2, 2 };
-                    for (int i = 0; i < 16; ++i) {
-                        int nx = current.x + dx[i], ny = current.y + dy[i];
-                        if (board->isValidPosition(nx, ny) && board->getPeg(nx, ny) == 1 && !visited[ny][nx]) {
-                            visited[ny][nx] = true; q.push({ nx, ny });
-                        }
-                    }
-                }
-            }
-        }
+SearchStatistics AISolver::getStatistics() const {
+    SearchStatistics statistics;
+    statistics.enabled = statistics_enabled;
+    lock_guard<mutex> lock(statistics_mutex);
+    statistics.answeredBy = answered_by;
+    for (const auto& counters : thread_counters) {
+        SearchStatistics::Thread thread;
+        thread.nodes = counters->nodes.load(memory_order_relaxed);
+        thread.tableProbes = counters->tableProbes.load(memory_order_relaxed);
+        thread.tableHits = counters->tableHits.load(memory_order_relaxed);
+        thread.tableStores = counters->tableStores.load(memory_order_relaxed);
+        thread.thresholdCutoffs = counters->thresholdCutoffs.load(memory_order_relaxed);
+        thread.bestDepthCutoffs = counters->bestDepthCutoffs.load(memory_order_relaxed);
+        thread.transpositionCutoffs = counters->transpositionCutoffs.load(memory_order_relaxed);
+        thread.pagodaCutoffs = counters->pagodaCutoffs.load(memory_order_relaxed);
+        thread.maxDepth = counters->maxDepth.load(memory_order_relaxed);
+        statistics.threads.push_back(thread);
     }
-    return islands > 0 ? islands - 1 : 0;
+    statistics.iterations = iterations;
+    statistics.memory = getMemoryUsage();
+    if (!iterations.empty() && !iterations.back().finished) {
+        // nodes_searched lags by up to a poll interval per thread; the per-thread counters are live
+        long long finished_nodes = 0;
+        for (const auto& iteration : iterations) finished_nodes += iteration.nodes;
+        statistics.iterations.back().nodes = statistics.total().nodes - finished_nodes;
+        statistics.iterations.back().milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - iteration_started).count();
+    }
+    return statistics;
+}
+
+SearchMemory AISolver::getMemoryUsage() const {
+    SearchMemory memory;
+    if (transposition_table) {
+        TranspositionTable::Statistics table = transposition_table->getStatistics();
+        memory.tableBytes = table.bytes;
+        memory.tableEntries = table.entries;
+        memory.tableUsed = table.used;
+    }
+    if (dead_positions) {
+        memory.deadBytes = dead_positions->bytes();
+        memory.deadEntries = dead_positions->capacity();
+        memory.deadUsed = dead_positions->size();
+    }
+    memory.layerBytes = layer_bytes.load(memory_order_relaxed);
+    return memory;
 }
 
-int AISolver::search_task(Board* board, int g_cost, int threshold,
-    vector<Move>& partialSolution,
-    unordered_map<string, int>& transpositionTable,
-    unordered_map<string, int>& heuristicCache) {
+SearchStatistics::Thread SearchStatistics::total() const {
+    Thread sum;
+    for (const Thread& t : threads) {
+        sum.nodes += t.nodes;
+        sum.tableProbes += t.tableProbes;
+        sum.tableHits += t.tableHits;
+        sum.tableStores += t.tableStores;
+        sum.thresholdCutoffs += t.thresholdCutoffs;
+        sum.bestDepthCutoffs += t.bestDepthCutoffs;
+        sum.transpositionCutoffs += t.transpositionCutoffs;
+        sum.pagodaCutoffs += t.pagodaCutoffs;
+        sum.maxDepth = (std::max)(sum.maxDepth, t.maxDepth);
+    }
+    return sum;
+}
 
-    if (force_stop.load()) return INT_MAX;
+void SearchStatistics::writeReport(ostream& out) const {
+    if (!enabled) {
+        out << "Search statistics are disabled." << endl;
+        return;
+    }
+    if (answeredBy) out << "answered by the " << answeredBy << ", no search ran" << endl;
+    auto writeThread = [&](const string& name, const Thread& t) {
+        out << name << ": " << t.nodes << " nodes, max depth " << t.maxDepth
+            << ", table " << t.tableProbes << " probes / " << t.tableHits << " hits / " << t.tableStores << " stores"
+            << ", cutoffs: threshold " << t.thresholdCutoffs << ", best depth " << t.bestDepthCutoffs
+            << ", transposition " << t.transpositionCutoffs << ", pagoda " << t.pagodaCutoffs << endl;
+    };
+    writeThread("total", total());
+    for (size_t i = 0; i < threads.size(); ++i) {
+        if (threads[i].nodes) writeThread(i + 1 == threads.size() ? string("caller") : "thread " + to_string(i), threads[i]);
+    }
+    for (const Iteration& iteration : iterations) {
+        out << "threshold " << iteration.threshold << ": " << iteration.nodes << " nodes, "
+            << iteration.milliseconds << " ms" << (iteration.finished ? "" : " (running)") << endl;
+    }
+    const size_t MB = 1024 * 1024;
+    out << "memory: " << memory.total() / MB << " MB";
+    if (memory.tableEntries) out << ", table " << memory.tableBytes / MB << " MB (" << memory.tableUsed << " of " << memory.tableEntries << " entries)";
+    if (memory.deadEntries) out << ", dead positions " << memory.deadBytes / MB << " MB (" << memory.deadUsed << " of " << memory.deadEntries << ")";
+    if (memory.layerBytes) out << ", layers " << memory.layerBytes / MB << " MB";
+    out << endl;
+}
+ostream& AISolver::logStream() const {
+    static thread_local ostream discard(nullptr);
+    return log_stream ? *log_stream : discard;
+}
 
+// Records the first limit the search reaches
+void AISolver::exhaust(SearchStop reason) {
+    SearchStop none = SearchStop::Finished;
+    stop_reason.compare_exchange_strong(none, reason);
+}
+
+// Waits while paused, then checks the time and node limits; false once the search is to end
+bool AISolver::checkBudget() {
     if (is_paused.load()) {
         std::unique_lock<std::mutex> lock(pause_mutex);
         pause_cond.wait(lock, [this] { return !is_paused.load() || force_stop.load(); });
     }
+    // A job's flags are its own and nobody notifies the solver of them, so they are polled
+    if (SolveJob* job = running_job.load()) {
+        while (job->paused.load() && !job->cancelled.load() && !force_stop.load()) this_thread::sleep_for(chrono::milliseconds(20));
+        if (job->cancelled.load()) force_stop = true;
+    }
+    if (budget.nodes > 0 && nodes_searched.load(memory_order_relaxed) >= budget.nodes) exhaust(SearchStop::NodeLimit);
+    if (budget.milliseconds > 0 &&
+        chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - search_start_time).count() >= budget.milliseconds) {
+        exhaust(SearchStop::TimeLimit);
+    }
+    return !force_stop.load() && stop_reason.load() == SearchStop::Finished;
+}
 
-    if (timed_out.load() || global_solution_found.load() || force_stop.load()) return INT_MAX;
+// Called by open_node every budget.pollInterval nodes, so a node itself reads no shared state.
+// Adds the thread's nodes to nodes_searched; false once the search is to end.
+bool AISolver::pollSearch() {
+    nodes_to_poll = budget.pollInterval;
+    nodes_searched.fetch_add(nodes_on_thread - nodes_reported, memory_order_relaxed);
+    nodes_reported = nodes_on_thread;
+    // Every solution is as long as any other, so one found anywhere ends the search
+    if (global_solution_found.load() || best_solution_depth.load(memory_order_relaxed) != INT_MAX) {
+        if (thread_stats) bump(thread_stats->bestDepthCutoffs);
+        return false;
+    }
+    return checkBudget();
+}
 
-    if (std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - search_start_time).count() > time_limit_ms) {
-        timed_out = true;
-        return INT_MAX;
+// Moves whose results are symmetric to an earlier move's are skipped
+vector<MoveIndex> AISolver::distinctMoves(const BitBoard& board) const {
+    MoveList moves;
+    board.getAllPossibleMoves(moves);
+    vector<MoveIndex> distinct;
+    vector<uint64_t> seen;
+    for (MoveIndex move : moves) {
+        BitBoard child = board;
+        child.makeMove(move);
+        uint64_t key = child.getCanonicalHash();
+        if (find(seen.begin(), seen.end(), key) != seen.end()) continue;
+        seen.push_back(key);
+        distinct.push_back(move);
     }
-    if (g_cost >= best_solution_depth) {
-        return INT_MAX;
+    return distinct;
+}
+
+bool AISolver::isCachedSolutionValid(const vector<MoveIndex>& path) const {
+    BitBoard board = rootBoard;
+    for (MoveIndex move : path) {
+        if (move >= board.getGeometry().getJumpCount() || !board.canJump(board.getGeometry().getJump(move))) return false;
+        board.makeMove(move);
+    }
+    return board.getPegCount() <= max_pegs_to_solve;
+}
+
+// Island neighbourhood: the 16 cells within one step or one jump in any of the eight directions.
+// islandDilation[byte][value] is the union of the neighbourhoods of those cells, so growing a
+// peg set by one step costs one lookup per byte of the mask.
+void AISolver::buildIslandTables(const BoardGeometry& geometry) {
+    const int dx[] = { -1, 1, 0, 0, -1, -1, 1, 1, -2, 2, 0, 0, -2, -2, 2, 2 };
+    const int dy[] = { 0, 0, -1, 1, -1, 1, -1, 1,  0, 0, -2, 2, -2, 2, -2, 2 };
+    int cells = geometry.getCellCount();
+    vector<BitMask> neighbours(cells, 0);
+    for (int cell = 0; cell < cells; ++cell) {
+        Position p = geometry.getCellPosition(cell);
+        for (int i = 0; i < 16; ++i) {
+            int neighbour = geometry.getCellIndex(p.x + dx[i], p.y + dy[i]);
+            if (neighbour >= 0) neighbours[cell] |= cellBit(neighbour);
+        }
+    }
+    island_geometry = geometry.getId();
+    island_byte_count = (cells + 7) / 8;
+    islandDilation.assign((size_t)island_byte_count * 256, 0);
+    for (int byte = 0; byte < island_byte_count; ++byte) {
+        for (int value = 0; value < 256; ++value) {
+            for (int bit = 0; bit < 8; ++bit) {
+                int cell = byte * 8 + bit;
+                if ((value >> bit) & 1 && cell < cells) islandDilation[byte * 256 + value] |= neighbours[cell];
+            }
+        }
+    }
+}
+
+int AISolver::estimateCost(const BitBoard& board) {
+    if (island_geometry != board.getGeometry().getId()) buildIslandTables(board.getGeometry());
+    return calculateHeuristic(board);
+}
+
+// Islands - 1, counted by flood fill on the peg mask: each island grows from its lowest peg
+// by whole-set dilation until it stops changing. Nothing is allocated.
+int AISolver::calculateHeuristic(const BitBoard& board) const {
+    const BitMask* table = islandDilation.data();
+    BitMask remaining = board.getPegs();
+    int islands = 0;
+    while (remaining) {
+        BitMask island = remaining & (~remaining + 1);
+        while (true) {
+            BitMask grown = island;
+            for (int byte = 0; byte < island_byte_count; ++byte) grown |= table[byte * 256 + ((island >> (8 * byte)) & 0xFF)];
+            grown &= remaining;
+            if (grown == island) break;
+            island = grown;
+        }
+        remaining &= ~island;
+        islands++;
     }
+    return islands > 0 ? islands - 1 : 0;
+}
 
-    string hash = board->getStateHash();
-    int h_cost;
-    auto cache_it = heuristicCache.find(hash);
-    if (cache_it != heuristicCache.end()) h_cost = cache_it->second;
-    else { h_cost = calculateHeuristic(board); heuristicCache[hash] = h_cost; }
+// Checks a node on entry: its value if it is cut off or solved, ABORTED once the search is over,
+// EXPANDED once its moves are in `frame`
+int AISolver::open_node(BitBoard& board, int g_cost, int threshold, SearchFrame& frame) {
+    if (--nodes_to_poll <= 0 && !pollSearch()) return ABORTED;
+    ++nodes_on_thread;
+    ThreadCounters* stats = thread_stats;
+    if (stats) {
+        bump(stats->nodes);
+        if (g_cost > stats->maxDepth.load(memory_order_relaxed)) stats->maxDepth.store(g_cost, memory_order_relaxed);
+    }
 
-    int f_cost = g_cost + h_cost;
-    if (f_cost > threshold) return f_cost;
+    if (pagodas->prunes(board.getPegs())) {
+        if (stats) bump(stats->pagodaCutoffs);
+        return INT_MAX;
+    }
 
-    auto tt_it = transpositionTable.find(hash);
-    if (tt_it != transpositionTable.end() && tt_it->second <= f_cost) return tt_it->second;
+    // The island count bounds the moves down to one peg. The depth-first threshold is exactly the
+    // moves down to the target, which that bound overshoots once the target is above one peg and
+    // never undercuts at one, so the depth-first pass goes without it.
+    if (!depth_first) {
+        int f_cost = g_cost + calculateHeuristic(board);
+        if (f_cost > threshold) {
+            if (stats) bump(stats->thresholdCutoffs);
+            return f_cost;
+        }
+    }
 
-    if (board->getPegCount() <= max_pegs_to_solve) {
+    // Stored bounds are relative to this position; g_cost is the same on every path to it
+    int remaining_bound;
+    if (stats) bump(stats->tableProbes);
+    if (depth_first) {
+        if (dead_positions->contains(board, max_pegs_to_solve, finish_cell)) {
+            if (stats) {
+                bump(stats->tableHits);
+                bump(stats->transpositionCutoffs);
+            }
+            return INT_MAX;
+        }
+    }
+    else if (transposition_table->probe(board, max_pegs_to_solve, remaining_bound)) {
+        if (stats) bump(stats->tableHits);
+        if (remaining_bound == INT_MAX || g_cost + remaining_bound > threshold) {
+            if (stats) bump(stats->transpositionCutoffs);
+            return remaining_bound == INT_MAX ? INT_MAX : g_cost + remaining_bound;
+        }
+    }
+
+    if (board.getPegCount() <= max_pegs_to_solve && (finish_cell < 0 || board.hasPeg(finish_cell))) {
         int current_best = best_solution_depth.load(std::memory_order_relaxed);
         while (g_cost < current_best) {
             if (best_solution_depth.compare_exchange_weak(current_best, g_cost, std::memory_order_release, std::memory_order_relaxed)) {
@@ -99,132 +452,571 @@ int AISolver::search_task(Board* board, int g_cost, int threshold,
         return FOUND;
     }
 
-    int min_surplus = INT_MAX;
-    vector<Move> possibleMoves = board->getAllPossibleMoves();
-    for (const Move& move : possibleMoves) {
-        board->makeMove(move);
-        int result = search_task(board, g_cost + 1, threshold, partialSolution, transpositionTable, heuristicCache);
-        board->undoMove();
+    frame.moves.size = 0;
+    board.getAllPossibleMoves(frame.moves);
+    move_orderer->order(frame.moves, g_cost, board.getPegs());
+    frame.next = 0;
+    frame.min_surplus = INT_MAX;
+    frame.best = -1;
+    frame.first_node = nodes_on_thread;
+    return EXPANDED;
+}
 
-        if (force_stop.load()) return INT_MAX;
+// Value of a node whose children have all been searched; an aborted search never gets here
+int AISolver::close_node(BitBoard& board, int g_cost, const SearchFrame& frame) {
+    int min_surplus = frame.min_surplus;
+    // The child closest to the threshold is the one the next iteration most likely solves through
+    if (frame.best >= 0) move_orderer->reward(frame.moves.moves[frame.best], g_cost, board.getPegCount() - max_pegs_to_solve);
+    if (thread_stats) bump(thread_stats->tableStores);
+    // The depth-first pass runs at the only depth a solution can have, so a node without one is
+    // dead, provided every child was proven dead rather than cut off at the threshold
+    long long work = nodes_on_thread - frame.first_node + 1;
+    if (depth_first) {
+        if (min_surplus == INT_MAX) dead_positions->insert(board, max_pegs_to_solve, finish_cell, work);
+    }
+    else transposition_table->store(board, max_pegs_to_solve, min_surplus == INT_MAX ? INT_MAX : min_surplus - g_cost, work);
+    return min_surplus;
+}
 
-        if (result == FOUND) {
-            partialSolution.insert(partialSolution.begin(), move); return FOUND;
+// Depth-first search without recursion: frames[d] holds the moves of the node d plies below
+// `board` and which of them is being searched, so the path is read off the frames by index.
+// The frames live on the thread and only grow, so a search allocates nothing once they fit.
+int AISolver::search_task(BitBoard& board, int g_cost, int threshold,
+    vector<MoveIndex>& partialSolution) {
+    static thread_local vector<SearchFrame> frame_stack;
+    size_t depth_needed = (size_t)board.getPegCount() + 1;
+    if (frame_stack.size() < depth_needed) frame_stack.resize(depth_needed);
+    SearchFrame* frames = frame_stack.data();
+
+    int result = open_node(board, g_cost, threshold, frames[0]);
+    if (result != EXPANDED) return result == ABORTED ? INT_MAX : result;
+    int top = 0;
+    while (true) {
+        SearchFrame& frame = frames[top];
+        if (frame.next < frame.moves.size) {
+            board.makeMove(frame.moves.moves[frame.next++]);
+            result = open_node(board, g_cost + top + 1, threshold, frames[top + 1]);
+            if (result == EXPANDED) { ++top; continue; }
+        }
+        else {
+            result = close_node(board, g_cost + top, frame);
+            if (top == 0) return result;
+            --top;
         }
-        if (result < min_surplus) min_surplus = result;
-    }
 
-    transpositionTable[hash] = min_surplus;
-    return min_surplus;
+        // `result` is the value of the child reached by the current move of frames[top]
+        SearchFrame& parent = frames[top];
+        board.undoMove(parent.moves.moves[parent.next - 1]);
+        if (result == FOUND || result == ABORTED) {
+            if (result == FOUND) {
+                partialSolution.resize(top + 1);
+                for (int ply = 0; ply <= top; ++ply) partialSolution[ply] = frames[ply].moves.moves[frames[ply].next - 1];
+            }
+            for (int ply = top - 1; ply >= 0; --ply) board.undoMove(frames[ply].moves.moves[frames[ply].next - 1]);
+            return result == FOUND ? FOUND : INT_MAX;
+        }
+        if (result < parent.min_surplus) {
+            parent.min_surplus = result;
+            parent.best = parent.next - 1;
+        }
+    }
 }
 
-int AISolver::threshold_worker(int initial_threshold, int step, ProgressCallback onProgress, int max_depth_estimate) {
-    int threshold = initial_threshold;
-    while (!global_solution_found.load() && !timed_out.load() && !force_stop.load()) {
-        if (threshold > max_depth_estimate + 2) {
-            cout << "Search depth exceeded maximum estimate. No solution likely." << endl;
-            return -1;
+void AISolver::split_task(BitBoard board, int g_cost, int threshold, vector<MoveIndex> path,
+    WorkStealingPool::TaskGroup& group, atomic<int>& next_threshold) {
+    if (global_solution_found.load() || stop_reason.load() != SearchStop::Finished || force_stop.load()) return;
+
+    // Near the root every child becomes its own task so idle workers can steal whole subtrees
+    if (g_cost < split_depth && board.getPegCount() > max_pegs_to_solve) {
+        for (MoveIndex move : distinctMoves(board)) {
+            BitBoard child = board;
+            child.makeMove(move);
+            vector<MoveIndex> childPath = path;
+            childPath.push_back(move);
+            pool->submit(group, [this, child, childPath, threshold, &group, &next_threshold]() {
+                this->split_task(child, (int)childPath.size(), threshold, childPath, group, next_threshold);
+            });
         }
+        return;
+    }
 
-        if (onProgress) {
-            onProgress(threshold, max_depth_estimate);
+    vector<MoveIndex> partialSolution;
+    thread_stats = countersOfThisThread();
+    int result = search_task(board, g_cost, threshold, partialSolution);
+    nodes_searched += nodes_on_thread - nodes_reported;
+    nodes_reported = nodes_on_thread;
+    if (result == FOUND) {
+        std::lock_guard<std::mutex> lock(solution_path_mutex);
+        if (force_stop.load() || global_solution_found.load()) return;
+        final_solution_path = path;
+        final_solution_path.insert(final_solution_path.end(), partialSolution.begin(), partialSolution.end());
+        global_solution_found = true;
+    }
+    else if (result < INT_MAX) {
+        int current_min = next_threshold.load();
+        while (result < current_min) {
+            if (next_threshold.compare_exchange_weak(current_min, result)) break;
         }
+    }
+}
+
+int AISolver::run_iteration(int threshold) {
+    atomic<int> next_threshold(INT_MAX);
+    WorkStealingPool::TaskGroup group;
+    split_task(rootBoard, 0, threshold, vector<MoveIndex>(), group, next_threshold);
+    group.wait();
+    return next_threshold.load();
+}
 
-        std::atomic<int> next_threshold_local = INT_MAX;
+// Bidirectional search
+//
+// A jump played backwards on a position is a jump played forwards on its complement, so the
+// backward half is an ordinary forward search from the complements of the finishing positions.
+// Every layer is a sorted vector with one peg mask per symmetry class; only the symmetries that
+// keep the finish hole in place are used, so both ends stay closed under them.
+
+namespace {
+struct LayerSymmetries {
+    const SymmetryGroup& group;
+    vector<int> transforms;
+
+    BitMask canonical(BitMask pegs) const {
+        BitMask best = pegs;
+        for (int t : transforms) best = (std::min)(best, group.apply(t, pegs));
+        return best;
+    }
+};
+}
 
-        vector<Move> rootMoves = initialBoard->getAllPossibleMoves();
-        if (rootMoves.empty()) return -1;
+// Positions one jump back from `pegs` whose class is in `layer`
+static bool findParent(const BoardGeometry& geometry, const LayerSymmetries& symmetries, const vector<BitMask>& layer,
+    BitMask pegs, BitMask& parent, MoveIndex& move) {
+    for (int j = 0; j < geometry.getJumpCount(); ++j) {
+        const Jump& jump = geometry.getJump((MoveIndex)j);
+        if ((pegs & jump.mask) != cellBit(jump.to)) continue;
+        BitMask candidate = pegs ^ jump.mask;
+        if (binary_search(layer.begin(), layer.end(), symmetries.canonical(candidate))) {
+            parent = candidate;
+            move = (MoveIndex)j;
+            return true;
+        }
+    }
+    return false;
+}
 
-        vector<future<void>> futures;
-        for (const auto& rootMove : rootMoves) {
-            futures.push_back(std::async(std::launch::async, [this, rootMove, threshold, &next_threshold_local]() {
-                if (this->global_solution_found.load() || this->timed_out.load() || this->force_stop.load()) return;
 
-                std::unique_ptr<Board> boardCopy = this->initialBoard->clone();
-                if (!boardCopy) return;
+bool AISolver::search_bidirectional(vector<MoveIndex>& path, ProgressCallback onProgress) {
+    // With a fixed finish hole fewer pegs than the target can be needed to bring one onto it
+    int most = (std::min)(max_pegs_to_solve, rootBoard.getPegCount());
+    int least = finish_cell < 0 ? most : 1;
+    for (int goal_pegs = most; goal_pegs >= least; --goal_pegs) {
+        bool met = meet_in_the_middle(goal_pegs, path, onProgress);
+        layer_bytes = 0; // the layers are freed on return
+        if (met) return true;
+        if (force_stop.load() || stop_reason.load() != SearchStop::Finished) break;
+    }
+    return false;
+}
 
-                boardCopy->makeMove(rootMove);
-                vector<Move> partialSolution;
-                unordered_map<string, int> tt, hc;
-                int result = this->search_task(boardCopy.get(), 1, threshold, partialSolution, tt, hc);
-                if (result == this->FOUND) {
-                    std::lock_guard<std::mutex> lock(this->solution_path_mutex);
-                    if (this->force_stop.load()) return;
+bool AISolver::meet_in_the_middle(int goal_pegs, vector<MoveIndex>& path, ProgressCallback onProgress) {
+    const size_t frontier_limit = size_t(1) << 26; // positions per layer, 512 MB
+    const size_t goal_limit = size_t(1) << 22;
+    const size_t chunk_size = 4096; // also the positions handled between two budget checks
+
+    const BoardGeometry& geometry = rootBoard.getGeometry();
+    BitMask valid = geometry.getValidMask();
+    int cells = geometry.getCellCount();
+    LayerSymmetries symmetries{ geometry.getSymmetries(), {} };
+    for (int t = 1; t < symmetries.group.size(); ++t) {
+        if (finish_cell < 0 || symmetries.group.cellImage(t, finish_cell) == finish_cell) symmetries.transforms.push_back(t);
+    }
 
-                    int new_solution_depth = (int)partialSolution.size() + 1;
-                    int current_best_depth = this->best_solution_depth.load();
+    // Forward depth first on odd totals: 16 + 15 plies on the cross
+    int depth = rootBoard.getPegCount() - goal_pegs;
+    int forward_depth = (depth + 1) / 2, backward_depth = depth - forward_depth;
+    vector<vector<BitMask>> forward(forward_depth + 1), backward(backward_depth + 1);
+    forward[0].push_back(symmetries.canonical(rootBoard.getPegs()));
+
+    // Complements of every finishing position, enumerated as the goal_pegs-subsets of the cells
+    BitMask required = finish_cell < 0 ? 0 : cellBit(finish_cell);
+    int free_cells = cells - (finish_cell < 0 ? 0 : 1), free_pegs = goal_pegs - (finish_cell < 0 ? 0 : 1);
+    if (free_pegs < 0 || free_pegs > free_cells) return false;
+    for (BitMask subset = free_pegs ? (BitMask(1) << free_pegs) - 1 : 0; ; ) {
+        if (backward[0].size() % chunk_size == 0 && !checkBudget()) return false;
+        // Spread the subset over the cells other than the finish hole
+        BitMask pegs = required;
+        for (int bit = 0, cell = 0; cell < cells; ++cell) {
+            if (cellBit(cell) & required) continue;
+            if ((subset >> bit++) & 1) pegs |= cellBit(cell);
+        }
+        backward[0].push_back(symmetries.canonical(valid & ~pegs));
+        if (backward[0].size() > goal_limit) {
+            logStream() << "Too many finishing positions for a bidirectional search." << endl;
+            return false;
+        }
+        if (free_pegs == 0) break;
+        BitMask low = subset & (~subset + 1), ripple = subset + low; // next subset of the same size
+        subset = ripple | (((subset ^ ripple) >> 2) / low);
+        if (subset >> free_cells) break;
+    }
+    if (!checkBudget()) return false;
+    sort(backward[0].begin(), backward[0].end());
+    if (!checkBudget()) return false;
+    backward[0].erase(unique(backward[0].begin(), backward[0].end()), backward[0].end());
+    size_t held = 1 + backward[0].size(); // positions in every layer so far
+    layer_bytes = held * sizeof(BitMask);
+
+    // Both frontiers grow one ply per round, their chunks spread over the pool together
+    for (int round = 1; round <= forward_depth; ++round) {
+        if (!checkBudget()) return false;
+        if (onProgress) onProgress(round, forward_depth);
+        auto round_start = chrono::steady_clock::now();
+        long long nodes_before = nodes_searched.load();
+        size_t iteration_index = 0;
+        if (statistics_enabled) {
+            lock_guard<mutex> lock(statistics_mutex);
+            SearchStatistics::Iteration iteration;
+            iteration.threshold = round;
+            iteration_index = iterations.size();
+            iteration_started = round_start;
+            iterations.push_back(iteration);
+        }
 
-                    if (new_solution_depth <= current_best_depth) {
-                        this->final_solution_path = partialSolution;
-                        this->final_solution_path.insert(this->final_solution_path.begin(), rootMove);
-                        this->global_solution_found = true;
-                    }
-                }
-                else if (result < INT_MAX) {
-                    int current_min = next_threshold_local.load();
-                    while (result < current_min) {
-                        if (next_threshold_local.compare_exchange_weak(current_min, result)) break;
+        vector<pair<vector<vector<BitMask>>*, int>> sides = { { &forward, round } };
+        if (round <= backward_depth) sides.push_back({ &backward, round });
+        vector<vector<BitMask>> children[2];
+        WorkStealingPool::TaskGroup group;
+        for (size_t side = 0; side < sides.size(); ++side) {
+            const vector<BitMask>& parents = (*sides[side].first)[round - 1];
+            size_t chunks = (parents.size() + chunk_size - 1) / chunk_size;
+            children[side].resize(chunks);
+            // Only the forward side can be pruned: pagodas bound what the finishing positions reach
+            const PagodaPruner* pruner = side == 0 ? pagodas.get() : nullptr;
+            for (size_t chunk = 0; chunk < chunks; ++chunk) {
+                vector<BitMask>* out = &children[side][chunk];
+                const BitMask* first = parents.data() + chunk * chunk_size;
+                size_t count = (std::min)(chunk_size, parents.size() - chunk * chunk_size);
+                pool->submit(group, [this, &geometry, &symmetries, pruner, out, first, count]() {
+                    if (!checkBudget()) return;
+                    ThreadCounters* stats = countersOfThisThread();
+                    // Parents are independent, so their moves are found MAX_LANES at a time
+                    MoveBatch batch(geometry);
+                    for (size_t i = 0; i < count; i += MoveBatch::MAX_LANES) {
+                        int lanes = (int)(std::min)(count - i, (size_t)MoveBatch::MAX_LANES);
+                        batch.evaluate(first + i, lanes, false);
+                        for (int lane = 0; lane < lanes; ++lane) {
+                            MoveList moves;
+                            batch.getMoves(lane, moves);
+                            for (MoveIndex move : moves) {
+                                BitMask child = first[i + lane] ^ geometry.getJump(move).mask;
+                                if (pruner && pruner->prunes(child)) {
+                                    if (stats) bump(stats->pagodaCutoffs);
+                                    continue;
+                                }
+                                out->push_back(symmetries.canonical(child));
+                            }
+                            if (stats) bump(stats->nodes);
+                        }
                     }
+                    sort(out->begin(), out->end());
+                    out->erase(unique(out->begin(), out->end()), out->end());
+                    nodes_searched += (long long)count;
+                });
+            }
+        }
+        group.wait();
+        if (!checkBudget()) return false;
+        for (size_t side = 0; side < sides.size(); ++side) {
+            vector<BitMask>& layer = (*sides[side].first)[sides[side].second];
+            size_t total = 0;
+            for (const auto& chunk : children[side]) total += chunk.size();
+            if (total > frontier_limit * 4) {
+                logStream() << "Bidirectional frontier exceeds " << frontier_limit << " positions." << endl;
+                return false;
+            }
+            // The new layer is held twice while it is merged: as chunks and as their merges
+            if (budget.tableBytes > 0 && (held + 2 * total) * sizeof(BitMask) > budget.tableBytes) {
+                exhaust(SearchStop::MemoryLimit);
+                return false;
+            }
+            // The sorted chunks are merged pairwise, so the budget is checked between merges
+            vector<vector<BitMask>>& parts = children[side];
+            while (parts.size() > 1) {
+                vector<vector<BitMask>> merged((parts.size() + 1) / 2);
+                WorkStealingPool::TaskGroup merges;
+                for (size_t i = 0; i + 1 < parts.size(); i += 2) {
+                    pool->submit(merges, [this, &parts, &merged, i]() {
+                        if (!checkBudget()) return;
+                        vector<BitMask>& out = merged[i / 2];
+                        out.resize(parts[i].size() + parts[i + 1].size());
+                        out.erase(set_union(parts[i].begin(), parts[i].end(), parts[i + 1].begin(), parts[i + 1].end(), out.begin()), out.end());
+                        vector<BitMask>().swap(parts[i]);
+                        vector<BitMask>().swap(parts[i + 1]);
+                    });
                 }
-                }));
+                if (parts.size() % 2) merged.back().swap(parts.back());
+                merges.wait();
+                if (!checkBudget()) return false;
+                parts.swap(merged);
+            }
+            if (!parts.empty()) layer.swap(parts[0]);
+            layer.shrink_to_fit();
+            if (layer.size() > frontier_limit) {
+                logStream() << "Bidirectional frontier exceeds " << frontier_limit << " positions." << endl;
+                return false;
+            }
+            held += layer.size();
+            layer_bytes = held * sizeof(BitMask);
         }
-        for (auto& f : futures) f.get();
-
-        if (global_solution_found.load()) {
-            return best_solution_depth.load();
+        logStream() << "Ply " << round << ": " << forward[round].size() << " forward, "
+            << (round <= backward_depth ? backward[round].size() : backward.back().size()) << " backward classes" << endl;
+        if (statistics_enabled) {
+            lock_guard<mutex> lock(statistics_mutex);
+            iterations[iteration_index].nodes = nodes_searched.load() - nodes_before;
+            iterations[iteration_index].milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - round_start).count();
+            iterations[iteration_index].finished = true;
         }
+        if (forward[round].empty() || (round <= backward_depth && backward[round].empty())) return false;
+    }
 
-        if (timed_out.load() || force_stop.load()) return -1;
-
-        int next_t = next_threshold_local.load();
-        if (next_t == INT_MAX) {
-            return -1;
+    // The frontiers meet where a forward position is the complement of a backward one
+    const vector<BitMask>& near = forward.back();
+    const vector<BitMask>& far = backward.back();
+    bool probe_forward = near.size() >= far.size();
+    const vector<BitMask>& built = probe_forward ? far : near;
+    unordered_set<BitMask> smaller;
+    smaller.reserve(built.size());
+    for (size_t i = 0; i < built.size(); ++i) {
+        if (i % chunk_size == 0 && !checkBudget()) return false;
+        smaller.insert(built[i]);
+    }
+    BitMask meeting = 0;
+    bool met = false;
+    size_t probes = 0;
+    for (BitMask pegs : probe_forward ? near : far) {
+        if (probes++ % chunk_size == 0 && !checkBudget()) return false;
+        if (smaller.count(symmetries.canonical(valid & ~pegs))) {
+            meeting = probe_forward ? pegs : valid & ~pegs;
+            met = true;
+            break;
         }
-
-        threshold = (std::max)(threshold + step, next_t);
     }
-    return -1;
+    if (!met) return false;
+
+    // Walk both halves back to their first layer, through positions of the stored classes
+    vector<MoveIndex> moves;
+    BitMask pegs = meeting;
+    for (int layer = forward_depth; layer > 0; --layer) {
+        BitMask parent;
+        MoveIndex move;
+        if (!findParent(geometry, symmetries, forward[layer - 1], pegs, parent, move)) return false;
+        moves.push_back(move);
+        pegs = parent;
+    }
+    reverse(moves.begin(), moves.end());
+    BitMask empty = valid & ~meeting;
+    for (int layer = backward_depth; layer > 0; --layer) {
+        BitMask parent;
+        MoveIndex move;
+        if (!findParent(geometry, symmetries, backward[layer - 1], empty, parent, move)) return false;
+        moves.push_back(move);
+        empty = parent;
+    }
+    // The forward walk ends on an image of the start; map the path back onto the start itself
+    int transform = -1;
+    if (pegs == rootBoard.getPegs()) transform = 0;
+    for (int t : symmetries.transforms) {
+        if (transform < 0 && symmetries.group.apply(t, rootBoard.getPegs()) == pegs) transform = t;
+    }
+    if (transform < 0) return false;
+    path = transformPath(symmetries.group, moves, symmetries.group.inverse(transform));
+    return true;
 }
 
 vector<Move> AISolver::findSolution(ProgressCallback onProgress) {
-    cout << "Starting AI solver with advanced parallel search..." << endl;
+    return findSolution(SearchBudget(), onProgress);
+}
 
-    string initialHash = initialBoard->getStateHash();
-    if (solutionCache.count(initialHash)) {
-        cout << "Solution found in cache!" << endl;
-        if (onProgress) onProgress(1, 1);
-        return solutionCache[initialHash];
-    }
+vector<Move> AISolver::findSolution(const SearchBudget& search_budget, ProgressCallback onProgress) {
+    return findSolution(*initialBoard, search_budget, onProgress);
+}
 
+vector<Move> AISolver::findSolution(const Board& board, const SearchBudget& search_budget, ProgressCallback onProgress) {
+    search_start_time = chrono::steady_clock::now();
+    budget = search_budget;
+    budget.pollInterval = (std::max)(1, budget.pollInterval);
+    stop_reason = SearchStop::Finished;
+    nodes_searched = 0;
+    logStream() << "Starting AI solver with advanced parallel search..." << endl;
+
+    // Reset before the tablebase and the store answer, so their answers leave no stale state
     global_solution_found = false;
-    timed_out = false;
     force_stop = false;
     final_solution_path.clear();
     best_solution_depth = INT_MAX;
+    layer_bytes = 0;
+    int desired_threads = thread_count > 0 ? thread_count : (int)(std::max)(1u, std::thread::hardware_concurrency());
+    {
+        lock_guard<mutex> lock(statistics_mutex);
+        answered_by = nullptr;
+        thread_counters.clear();
+        iterations.clear();
+        if (statistics_enabled) {
+            for (int i = 0; i <= desired_threads; ++i) thread_counters.push_back(make_unique<ThreadCounters>());
+        }
+    }
 
-    search_start_time = std::chrono::high_resolution_clock::now();
-    int base_threshold = calculateHeuristic(initialBoard);
+    rootBoard = board.toBitBoard();
+    // The store holds solutions of canonical positions; map them back through the inverse symmetry
+    const SymmetryGroup& symmetries = rootBoard.getGeometry().getSymmetries();
+    uint64_t fingerprint = rootBoard.getGeometry().getFingerprint();
+    int root_transform;
+    uint64_t initialHash = rootBoard.getCanonicalHash(root_transform);
+    vector<MoveIndex> cached;
+    SolutionStore& store = solution_store ? *solution_store : SolutionStore::shared();
+    // Small boards and prepared levels are answered by their tablebase; tables and stored solutions finish anywhere.
+    // A missing table of a small board is built within the budget.
+    const Tablebase* tablebase = finish_cell < 0 ? TablebaseLibrary::shared().findOrBuild(rootBoard.getGeometry(), max_pegs_to_solve,
+        rootBoard.getPegs(), [this] { return checkBudget(); }) : nullptr;
+    if (tablebase) {
+        vector<MoveIndex> path;
+        if (search_mode != SearchMode::IterativeDeepening) {
+            logStream() << "The tablebase answers this position; the "
+                << (search_mode == SearchMode::DepthFirst ? "depth-first" : "bidirectional") << " search is not run." << endl;
+        }
+        {
+            lock_guard<mutex> lock(statistics_mutex);
+            answered_by = "tablebase";
+        }
+        if (onProgress) onProgress(1, 1);
+        if (tablebase->solve(rootBoard.getPegs(), path)) {
+            logStream() << "Solution found in tablebase!" << endl;
+            return toMoves(board, path);
+        }
+        logStream() << "No solution found (tablebase)." << endl;
+        return {};
+    }
+    if (finish_cell < 0 && store.find(fingerprint, max_pegs_to_solve, initialHash, cached)) {
+        vector<MoveIndex> path = transformPath(symmetries, cached, symmetries.inverse(root_transform));
+        // Replayed whatever the verification setting: the store is read from disk and may be stale
+        if (isCachedSolutionValid(path)) {
+            logStream() << "Solution found in cache!" << endl;
+            {
+                lock_guard<mutex> lock(statistics_mutex);
+                answered_by = "solution store";
+            }
+            if (onProgress) onProgress(1, 1);
+            return toMoves(board, path);
+        }
+        hash_collisions++;
+    }
 
-    int max_depth_estimate = initialBoard->getPegCount() - 1;
-    int num_supervisor_threads = (std::max)(1u, std::thread::hardware_concurrency() / 2);
+    buildIslandTables(rootBoard.getGeometry());
+    vector<vector<int>> pagoda_weights;
+    if (pagoda_pruning) {
+        for (const auto& entry : PagodaLibrary::shared().find(fingerprint, -1)) pagoda_weights.push_back(entry.weights);
+        if (finish_cell >= 0) {
+            for (const auto& entry : PagodaLibrary::shared().find(fingerprint, finish_cell)) pagoda_weights.push_back(entry.weights);
+        }
+    }
+    pagodas = make_unique<PagodaPruner>(rootBoard.getGeometry(), pagoda_weights, max_pegs_to_solve, finish_cell);
+    move_orderer = make_unique<MoveOrderer>(rootBoard.getGeometry(), move_ordering, move_model);
+
+    int base_threshold = calculateHeuristic(rootBoard);
 
-    vector<future<int>> supervisor_futures;
-    for (int i = 0; i < num_supervisor_threads; ++i) {
-        supervisor_futures.push_back(std::async(std::launch::async, &AISolver::threshold_worker, this, base_threshold + i, num_supervisor_threads, onProgress, max_depth_estimate));
+    int max_depth_estimate = rootBoard.getPegCount() - 1;
+    if (!pool || pool->getThreadCount() != desired_threads) pool = make_unique<WorkStealingPool>(desired_threads);
+
+    bool bidirectional = search_mode == SearchMode::Bidirectional || (finish_cell >= 0 && search_mode != SearchMode::DepthFirst);
+    if (bidirectional) {
+        vector<MoveIndex> path;
+        if (search_bidirectional(path, onProgress)) {
+            final_solution_path = path;
+            global_solution_found = true;
+        }
+    }
+    // Every jump removes one peg, so a solution has exactly this many moves; the depth-first
+    // pass searches that depth alone, pruning as IDA* would with it as the threshold. Bringing a
+    // peg onto the finish hole may take the board below the target, down to one peg.
+    depth_first = !bidirectional && search_mode == SearchMode::DepthFirst;
+    // The shared tables are only taken, and so allocated, by a search that uses them
+    {
+        lock_guard<mutex> lock(statistics_mutex);
+        if (depth_first && !dead_positions) setDeadPositionSet(DeadPositionSet::shared());
+        if (!bidirectional && !depth_first && !transposition_table) setTranspositionTable(TranspositionTable::shared());
+    }
+    int fewest_pegs = finish_cell < 0 ? max_pegs_to_solve : 1;
+    int threshold = depth_first ? (std::max)(0, rootBoard.getPegCount() - fewest_pegs) : base_threshold;
+    while (!bidirectional && !global_solution_found.load() && stop_reason.load() == SearchStop::Finished && !force_stop.load()) {
+        if (threshold > max_depth_estimate + 2) {
+            logStream() << "Search depth exceeded maximum estimate. No solution likely." << endl;
+            break;
+        }
+        if (onProgress) {
+            onProgress(threshold, max_depth_estimate);
+        }
+        auto iteration_start = chrono::steady_clock::now();
+        long long nodes_before = nodes_searched.load();
+        size_t iteration_index = 0;
+        if (statistics_enabled) {
+            lock_guard<mutex> lock(statistics_mutex);
+            SearchStatistics::Iteration iteration;
+            iteration.threshold = threshold;
+            iteration_index = iterations.size();
+            iteration_started = iteration_start;
+            iterations.push_back(iteration);
+        }
+        int next_t = run_iteration(threshold);
+        if (statistics_enabled) {
+            lock_guard<mutex> lock(statistics_mutex);
+            iterations[iteration_index].nodes = nodes_searched.load() - nodes_before;
+            iterations[iteration_index].milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - iteration_start).count();
+            iterations[iteration_index].finished = true;
+        }
+        if (depth_first || next_t == INT_MAX) break;
+        threshold = next_t;
+        move_orderer->age();
     }
 
-    for (auto& f : supervisor_futures) f.get();
+    if (depth_first) {
+        logStream() << "Dead positions: " << dead_positions->size() << " held (" << dead_positions->bytes() / (1024 * 1024) << " MB shared)" << endl;
+    }
+    else if (!bidirectional) {
+        TranspositionTable::Statistics tt_stats = transposition_table->getStatistics();
+        logStream() << "Transposition table: " << tt_stats.probes << " probes, " << tt_stats.hits << " hits, "
+            << tt_stats.replacements << " replacements, " << tt_stats.collisions << " collisions ("
+            << tt_stats.bytes / (1024 * 1024) << " MB shared)" << endl;
+    }
+    if (statistics_enabled) getStatistics().writeReport(logStream());
 
     if (global_solution_found.load()) {
-        cout << "Optimal solution found with depth: " << final_solution_path.size() << endl;
-        solutionCache[initialHash] = final_solution_path;
+        // A limit other threads reached after the solution was found did not end the search
+        stop_reason = SearchStop::Finished;
+        logStream() << "Optimal solution found with depth: " << final_solution_path.size() << endl;
+        if (finish_cell < 0) store.insert(fingerprint, max_pegs_to_solve, initialHash, transformPath(symmetries, final_solution_path, root_transform));
         if (onProgress) onProgress(1, 1);
-        return final_solution_path;
+        return toMoves(board, final_solution_path);
     }
 
-    if (timed_out.load()) cout << "AI Search Timed Out!" << endl;
-    else if (force_stop.load()) cout << "AI Search was interrupted by user." << endl;
-    else cout << "No solution found." << endl;
+    if (force_stop.load()) exhaust(SearchStop::Stopped);
+    switch (stop_reason.load()) {
+    case SearchStop::TimeLimit: logStream() << "AI Search Timed Out!" << endl; break;
+    case SearchStop::NodeLimit: logStream() << "AI search reached its node limit." << endl; break;
+    case SearchStop::MemoryLimit: logStream() << "AI search reached its memory limit." << endl; break;
+    case SearchStop::Stopped: logStream() << "AI Search was interrupted by user." << endl; break;
+    default: logStream() << "No solution found." << endl; break;
+    }
     if (onProgress) onProgress(1, 1);
     return {};
+}
+
+vector<Move> AISolver::toMoves(const vector<MoveIndex>& path) const {
+    return toMoves(*initialBoard, path);
+}
+
+vector<Move> AISolver::toMoves(const Board& board, const vector<MoveIndex>& path) {
+    vector<Move> moves;
+    moves.reserve(path.size());
+    for (MoveIndex index : path) moves.push_back(board.getMove(index));
+    return moves;
 }
\ No newline at end of file
@@ -3,23 +3,131 @@
 #define AI_SOLVER_H
 #include <vector>
 #include <string>
+#include <cstdint>
 #include <map>
 #include <functional>
+#include <iosfwd>
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
-#include <unordered_map>
+#include <deque>
+#include <future>
+#include <memory>
+#include <thread>
 #include "board.h" 
-// ... (Move ṹ ProgressCallback Ͷ屣ֲ) ...
+#include "transposition_table.h"
+#include "dead_position_set.h"
+#include "thread_pool.h"
+#include "solution_store.h"
+#include "pagoda.h"
+#include "tablebase.h"
+#include "move_ordering.h"
+#include "move_batch.h"
+// ... (Move 结构体和 ProgressCallback 类型定义保持不变) ...
 struct Move {
     int from_x, from_y, over_x, over_y, to_x, to_y;
     Move() : from_x(-1), from_y(-1), over_x(-1), over_y(-1), to_x(-1), to_y(-1) {}
     Move(int fx, int fy, int ox, int oy, int tx, int ty) : from_x(fx), from_y(fy), over_x(ox), over_y(oy), to_x(tx), to_y(ty) {}
 };
 using ProgressCallback = std::function<void(int current_cost, int max_possible_cost)>;
-extern std::map<std::string, std::vector<Move>> solutionCache;
-// AI 
+
+// Memory of the tables a solver searches with, see AISolver::getMemoryUsage. The transposition
+// table and dead-position set are allocated in full up front and may be shared with other solvers.
+struct SearchMemory {
+    std::size_t tableBytes = 0, tableEntries = 0, tableUsed = 0; // transposition table
+    std::size_t deadBytes = 0, deadEntries = 0, deadUsed = 0;    // dead-position set
+    std::size_t layerBytes = 0; // bidirectional layers held by the running search
+    std::size_t total() const { return tableBytes + deadBytes + layerBytes; }
+};
+// Counters of one findSolution call, see AISolver::getStatistics
+struct SearchStatistics {
+    struct Thread {
+        long long nodes = 0;
+        long long tableProbes = 0, tableHits = 0, tableStores = 0; // the dead-position set in depth-first mode
+        long long thresholdCutoffs = 0;    // f = g + h above the iteration's threshold
+        long long bestDepthCutoffs = 0;    // polls that found a solution had been found elsewhere
+        long long transpositionCutoffs = 0; // stored bound above the threshold, or unsolvable; known dead in depth-first mode
+        long long pagodaCutoffs = 0;       // a pagoda proves the position hopeless
+        int maxDepth = 0;
+    };
+    struct Iteration {
+        int threshold = 0;
+        long long nodes = 0;
+        double milliseconds = 0;
+        bool finished = false; // false while the iteration is still running
+    };
+    bool enabled = false;
+    const char* answeredBy = nullptr; // "tablebase" or "solution store" when no search ran
+    std::vector<Thread> threads; // one per pool worker, the last one is the calling thread
+    std::vector<Iteration> iterations;
+    SearchMemory memory;
+
+    Thread total() const;
+    void writeReport(std::ostream& out) const;
+};
+// Limits of one findSolution call; 0 = no limit
+struct SearchBudget {
+    long long milliseconds = 600000; // wall time
+    long long nodes = 0;             // positions expanded
+    // Memory of the tables the search grows while it runs: the bidirectional layers. The
+    // transposition table and dead-position set have a fixed size and are not counted.
+    std::size_t tableBytes = 0;
+    // Nodes a search thread expands between checks of the limits, stop() and pause(); the
+    // search ends at most this many nodes per thread after a limit is reached
+    int pollInterval = 1024;
+};
+// What ended the last findSolution call
+enum class SearchStop {
+    Finished,    // solved, or proven unsolvable
+    TimeLimit,
+    NodeLimit,
+    MemoryLimit,
+    Stopped,     // AISolver::stop()
+};
+// How findSolution searches
+enum class SearchMode {
+    IterativeDeepening, // parallel IDA* over the island heuristic
+    Bidirectional,      // breadth-first layers from the start and from the finishing positions, meeting halfway
+    DepthFirst,         // one depth-first pass at the only depth a solution can have, remembering dead positions
+};
+// What a job queued by AISolver::solveAsync produced
+struct SolveResult {
+    std::vector<Move> moves;                // empty unless solved
+    SearchStop stop = SearchStop::Finished; // Stopped once the job was cancelled
+    long long nodes = 0;                    // positions expanded
+};
+// Handle of a job queued by AISolver::solveAsync. Its state is atomics the solver's job thread
+// writes and the search polls, so any thread can read and steer it without locks, and the handle
+// never refers back to the solver: it stays valid after the solver is gone.
+class SolveJob {
+public:
+    enum class State { Queued, Running, Done };
+    State getState() const { return state.load(); }
+    // The future is ready
+    bool isDone() const;
+    // Latest progress report of the search, 0..1
+    float getProgress() const;
+    // A queued job never starts and its future is ready at once. A running search ends within
+    // SearchBudget::pollInterval nodes per thread, or 20 ms while paused.
+    void cancel();
+    bool isCancelled() const { return cancelled.load(); }
+    void pause() { paused = true; }
+    void resume() { paused = false; }
+    bool isPaused() const { return paused.load(); }
+    std::shared_future<SolveResult> getFuture() const { return future; }
+private:
+    friend class AISolver;
+    SolveJob() = default;
+    std::unique_ptr<Board> board; // copy the job searches
+    SearchBudget budget;
+    std::atomic<State> state{ State::Queued };
+    std::atomic<bool> cancelled{ false }, paused{ false };
+    std::atomic<int> progress{ 0 }, progressMax{ 0 };
+    std::promise<SolveResult> promise;
+    std::shared_future<SolveResult> future;
+};
+// AI 求解器类
 class AISolver {
 private:
     Board* initialBoard;
@@ -29,26 +137,146 @@ private:
     std::atomic<bool> is_paused;
     std::mutex pause_mutex;
     std::condition_variable pause_cond;
-    std::atomic<bool> timed_out;
-    std::atomic<bool> force_stop; // [ADDED] ǿֹͣ־
+    std::atomic<SearchStop> stop_reason; // the first limit reached, Finished while there is none
+    std::atomic<bool> force_stop; // [ADDED] 添加强制停止标志
     std::atomic<int> best_solution_depth;
     std::mutex solution_path_mutex;
-    std::vector<Move> final_solution_path;
-    std::chrono::time_point<std::chrono::high_resolution_clock> search_start_time;
-    const long long time_limit_ms = 600000; // 10ӳʱ
-    int calculateHeuristic(const Board* board);
-    int search_task(Board* board, int g_cost, int threshold,
-        std::vector<Move>& partialSolution,
-        std::unordered_map<std::string, int>& transpositionTable,
-        std::unordered_map<std::string, int>& heuristicCache);
-    int threshold_worker(int initial_threshold, int step, ProgressCallback onProgress, int max_depth_estimate);
+    std::vector<MoveIndex> final_solution_path;
+    std::chrono::time_point<std::chrono::steady_clock> search_start_time;
+    SearchBudget budget; // of the running findSolution call
+    BitBoard rootBoard;
+    bool verify_hashes;
+    std::atomic<long long> hash_collisions;
+    TranspositionTable* transposition_table;
+    DeadPositionSet* dead_positions;
+    SolutionStore* solution_store; // nullptr = SolutionStore::shared(), opened on first use
+    std::ostream* log_stream;
+    int thread_count;
+    int split_depth;
+    std::unique_ptr<WorkStealingPool> pool;
+    int island_geometry; // geometry id islandDilation was built for
+    int island_byte_count;
+    bool pagoda_pruning;
+    std::unique_ptr<PagodaPruner> pagodas; // PagodaLibrary tables of the root's geometry
+    SearchMode search_mode;
+    int finish_cell; // hole the last peg must end in, -1 = any
+    bool depth_first; // the running search is the SearchMode::DepthFirst pass
+    MoveOrdering move_ordering;
+    const MoveModel* move_model; // for MoveOrdering::learned, nullptr = none
+    std::unique_ptr<MoveOrderer> move_orderer; // scores of the running search
+    std::atomic<long long> nodes_searched;
+    std::atomic<std::size_t> layer_bytes; // bidirectional layers held
+    // solveAsync's queue, run one job at a time by job_thread, started on first use
+    std::mutex job_mutex;
+    std::condition_variable job_cond;
+    std::deque<std::shared_ptr<SolveJob>> job_queue;
+    std::atomic<SolveJob*> running_job; // polled by checkBudget, nullptr outside jobs
+    bool jobs_closing;
+    std::thread job_thread;
+    void runJobs();
+    // Written only by their own thread, read by getStatistics at any time
+    struct alignas(64) ThreadCounters {
+        std::atomic<long long> nodes{ 0 }, tableProbes{ 0 }, tableHits{ 0 }, tableStores{ 0 };
+        std::atomic<long long> thresholdCutoffs{ 0 }, bestDepthCutoffs{ 0 }, transpositionCutoffs{ 0 }, pagodaCutoffs{ 0 };
+        std::atomic<int> maxDepth{ 0 };
+    };
+    bool statistics_enabled;
+    const char* answered_by; // see SearchStatistics::answeredBy
+    mutable std::mutex statistics_mutex; // guards thread_counters resizing and iterations
+    std::vector<std::unique_ptr<ThreadCounters>> thread_counters;
+    std::vector<SearchStatistics::Iteration> iterations;
+    std::chrono::steady_clock::time_point iteration_started;
+    static thread_local ThreadCounters* thread_stats; // slot for the task this thread is running, nullptr when off
+    ThreadCounters* countersOfThisThread();
+    std::vector<BitMask> islandDilation; // [byte][value] -> island neighbourhood of those cells
+    void buildIslandTables(const BoardGeometry& geometry);
+    int calculateHeuristic(const BitBoard& board) const;
+    bool isCachedSolutionValid(const std::vector<MoveIndex>& path) const;
+    std::vector<MoveIndex> distinctMoves(const BitBoard& board) const;
+    void exhaust(SearchStop reason);
+    bool checkBudget();
+    bool pollSearch();
+    std::ostream& logStream() const;
+    // One ply of search_task's explicit stack
+    struct SearchFrame {
+        MoveList moves;
+        int next = 0;          // index in moves of the move after the one being searched
+        int min_surplus = 0;   // smallest value returned by the children so far
+        int best = -1;         // index in moves of the child that returned it
+        long long first_node = 0; // the thread's node count when the node was expanded
+    };
+    int open_node(BitBoard& board, int g_cost, int threshold, SearchFrame& frame);
+    int close_node(BitBoard& board, int g_cost, const SearchFrame& frame);
+    int search_task(BitBoard& board, int g_cost, int threshold,
+        std::vector<MoveIndex>& partialSolution);
+    void split_task(BitBoard board, int g_cost, int threshold, std::vector<MoveIndex> path,
+        WorkStealingPool::TaskGroup& group, std::atomic<int>& next_threshold);
+    int run_iteration(int threshold);
+    bool search_bidirectional(std::vector<MoveIndex>& path, ProgressCallback onProgress);
+    bool meet_in_the_middle(int goal_pegs, std::vector<MoveIndex>& path, ProgressCallback onProgress);
+    // The public findSolution searches initialBoard; a job searches its own copy
+    std::vector<Move> findSolution(const Board& board, const SearchBudget& budget, ProgressCallback onProgress);
+    static std::vector<Move> toMoves(const Board& board, const std::vector<MoveIndex>& path);
 public:
     AISolver(Board* board, int target_pegs = 1);
+    ~AISolver();
     void pause();
     void resume();
-    void stop(); // [ADDED] ֹͣ
+    void stop(); // [ADDED] 添加停止方法
     bool isPaused() const;
     bool hasTimedOut() const;
+    // Why the last findSolution call ended
+    SearchStop getStopReason() const;
+    // Compare full peg masks on every hit in the transposition table and the dead-position set;
+    // mismatches count as collisions and are treated as misses.
+    // Solutions from the store are replayed on the board either way, and count as collisions when illegal.
+    void setHashVerification(bool enabled);
+    long long getHashCollisions() const;
+    // Defaults to TranspositionTable::shared(), taken by the first IDA* search; the table must outlive the solver
+    void setTranspositionTable(TranspositionTable& table);
+    TranspositionTable::Statistics getTranspositionStatistics() const;
+    // Defaults to DeadPositionSet::shared(), taken by the first depth-first search; the set must outlive the solver
+    void setDeadPositionSet(DeadPositionSet& set);
+    // Defaults to SolutionStore::shared(); the store must outlive the solver
+    void setSolutionStore(SolutionStore& store);
+    // Progress messages go here, std::cout by default; nullptr silences them
+    void setLogStream(std::ostream* stream);
+    // Positions expanded by the last findSolution call
+    long long getNodesSearched() const;
+    // Per-thread and per-iteration counters; off by default, when off the search only skips a null check.
+    // Takes effect at the next findSolution call.
+    void setStatisticsEnabled(bool enabled);
+    // Snapshot of the running search, or the final report once findSolution has returned
+    SearchStatistics getStatistics() const;
+    // Live, whether statistics are enabled or not
+    SearchMemory getMemoryUsage() const;
+    // Cut subtrees a pagoda of PagodaLibrary::shared() proves hopeless (on by default)
+    void setPagodaPruning(bool enabled);
+    void setSearchMode(SearchMode mode);
+    // Order in which the IDA* search tries children; defaults to the board's getMoveOrdering()
+    void setMoveOrdering(const MoveOrdering& ordering);
+    // Scores children for MoveOrdering::learned; a model of another geometry is ignored.
+    // The model must outlive the solver.
+    void setMoveModel(const MoveModel* model);
+    // Hole the last peg has to end in, (-1, -1) = any. The bidirectional and depth-first searches
+    // aim at a hole, so IDA* gives way to the bidirectional search while one is set; such
+    // solutions bypass the solution store.
+    void setFinishHole(int x, int y);
+    // Island heuristic of `board`: a lower bound on the moves still needed
+    int estimateCost(const BitBoard& board);
+    // Worker threads of the solver's pool, 0 = one per hardware thread
+    void setThreadCount(int threads);
+    // Plies below the root whose children are queued as separate tasks
+    void setSplitDepth(int depth);
     std::vector<Move> findSolution(ProgressCallback onProgress = nullptr);
+    std::vector<Move> findSolution(const SearchBudget& budget, ProgressCallback onProgress = nullptr);
+    std::vector<Move> toMoves(const std::vector<MoveIndex>& path) const;
+    // Queues a search of a copy of `board` under the solver's settings and returns at once; jobs
+    // run one after another on a thread the solver owns, with the solver's search threads. The
+    // destructor cancels what is left and waits for the running job to end.
+    // findSolution must not be called while jobs are queued.
+    std::shared_ptr<SolveJob> solveAsync(const Board& board, const SearchBudget& budget = SearchBudget());
+    // Cancels every queued and running job, e.g. when a new position supersedes them
+    void cancelAll();
 };
 #endif // AI_SOLVER_H
\ No newline at end of file
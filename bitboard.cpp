@@ -0,0 +1,100 @@
+#include "bitboard.h"
+#include "symmetry.h"
+#include <atomic>
+#include <stdexcept>
+
+using namespace std;
+
+static uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+BoardGeometry::BoardGeometry(int w, int h, const function<bool(int, int)>& isHole,
+    const vector<pair<int, int>>& directions)
+    : width(w), height(h), cellIndex(w * h, -1), validMask(0) {
+    static atomic<int> nextId(1);
+    id = nextId++;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            if (!isHole(x, y)) continue;
+            if (cellPositions.size() >= 64) throw invalid_argument("BoardGeometry: more than 64 holes");
+            cellIndex[y * width + x] = (int)cellPositions.size();
+            validMask |= cellBit((int)cellPositions.size());
+            cellPositions.push_back(Position(x, y));
+        }
+    }
+    // Deterministic keys so hashes stay stable across runs
+    uint64_t seed = validMask ^ ((uint64_t)width << 56) ^ ((uint64_t)height << 48);
+    for (int cell = 0; cell < getCellCount(); ++cell) zobristKeys.push_back(splitMix64(seed));
+
+    for (int cell = 0; cell < getCellCount(); ++cell) {
+        Position p = cellPositions[cell];
+        for (const auto& dir : directions) {
+            // Same parity rule as Board::isValidMove: a jump spans two holes
+            if ((dir.first == 0 && dir.second == 0) || dir.first % 2 != 0 || dir.second % 2 != 0) continue;
+            int over = getCellIndex(p.x + dir.first / 2, p.y + dir.second / 2);
+            int to = getCellIndex(p.x + dir.first, p.y + dir.second);
+            if (over < 0 || to < 0) continue;
+            Jump jump;
+            jump.from = (int8_t)cell;
+            jump.over = (int8_t)over;
+            jump.to = (int8_t)to;
+            jump.mask = cellBit(cell) | cellBit(over) | cellBit(to);
+            jump.hash = zobristKeys[cell] ^ zobristKeys[over] ^ zobristKeys[to];
+            jumps.push_back(jump);
+        }
+    }
+    if (jumps.size() > MAX_JUMPS) throw invalid_argument("BoardGeometry: jump table does not fit MoveIndex");
+    // Shape and jump table together; move indices in stored paths are only meaningful for an equal table
+    fingerprint = validMask ^ ((uint64_t)width << 56) ^ ((uint64_t)height << 48);
+    for (const Jump& jump : jumps) {
+        uint64_t state = fingerprint ^ ((uint64_t)(uint8_t)jump.from << 8) ^ (uint64_t)(uint8_t)jump.to;
+        fingerprint = splitMix64(state);
+    }
+
+    symmetries = make_shared<SymmetryGroup>(*this);
+    symmetryCount = symmetries->size();
+    if (symmetryCount > MAX_SYMMETRIES) throw invalid_argument("BoardGeometry: too many symmetries");
+    for (int move = 0; move < getJumpCount(); ++move) {
+        for (int t = 0; t < symmetryCount; ++t) symmetricJumpHashes.push_back(symmetries->jumpHash(t, (MoveIndex)move));
+    }
+}
+
+int BoardGeometry::findJump(int fromX, int fromY, int toX, int toY) const {
+    int from = getCellIndex(fromX, fromY), to = getCellIndex(toX, toY);
+    if (from < 0 || to < 0) return -1;
+    for (int i = 0; i < getJumpCount(); ++i) {
+        if (jumps[i].from == from && jumps[i].to == to) return i;
+    }
+    return -1;
+}
+
+uint64_t BoardGeometry::hashPegs(BitMask pegs) const {
+    uint64_t hash = 0;
+    while (pegs) {
+        hash ^= zobristKeys[lowestBit(pegs)];
+        pegs &= pegs - 1;
+    }
+    return hash;
+}
+
+BitBoard::BitBoard(const BoardGeometry& g, BitMask p) : geometry(&g), pegs(p), hashes() {
+    for (int t = 0; t < g.getSymmetryCount(); ++t) hashes[t] = g.hashPegs(g.getSymmetries().apply(t, p));
+}
+
+BitMask BitBoard::getCanonicalPegs() const {
+    int transform;
+    getCanonicalHash(transform);
+    return geometry->getSymmetries().apply(transform, pegs);
+}
+
+void BitBoard::getAllPossibleMoves(MoveList& moves) const {
+    moves.size = 0;
+    int jumpCount = geometry->getJumpCount();
+    for (int i = 0; i < jumpCount; ++i) {
+        if (canJump(geometry->getJump((MoveIndex)i))) moves.moves[moves.size++] = (MoveIndex)i;
+    }
+}
@@ -0,0 +1,167 @@
+// bitboard.h
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <utility>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Struct for a position on the board
+struct Position {
+    int x, y;
+    Position(int px = -1, int py = -1) : x(px), y(py) {}
+    bool operator==(const Position& other) const { return x == other.x && y == other.y; }
+};
+
+// One bit per hole, numbered row-major over the valid holes of a geometry
+using BitMask = std::uint64_t;
+
+inline int popCount(BitMask mask) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    return (int)__popcnt64(mask);
+#elif defined(_MSC_VER)
+    return (int)(__popcnt((unsigned int)mask) + __popcnt((unsigned int)(mask >> 32)));
+#else
+    return __builtin_popcountll(mask);
+#endif
+}
+
+// Index of the lowest set bit, mask must be non-zero
+inline int lowestBit(BitMask mask) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (int)index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanForward(&index, (unsigned long)mask)) return (int)index;
+    _BitScanForward(&index, (unsigned long)(mask >> 32));
+    return (int)index + 32;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+inline BitMask cellBit(int cell) { return BitMask(1) << cell; }
+
+// A single jump: the peg on `from` jumps over `over` and lands on `to`.
+// `mask` has the three cells set, so applying or reverting the jump is one XOR;
+// `hash` is the XOR of the three cells' Zobrist keys and updates the position hash the same way.
+struct Jump {
+    std::int8_t from, over, to;
+    BitMask mask;
+    std::uint64_t hash;
+};
+
+// Index of a jump in its geometry's jump table; solution paths are stored as these
+using MoveIndex = std::uint8_t;
+const int MAX_JUMPS = 256;
+
+// Fixed-capacity list of legal moves, lives on the stack of the caller
+struct MoveList {
+    MoveIndex moves[MAX_JUMPS];
+    int size = 0;
+    const MoveIndex* begin() const { return moves; }
+    const MoveIndex* end() const { return moves + size; }
+    bool empty() const { return size == 0; }
+};
+
+// Upper bound on the size of a geometry's symmetry group (a lattice has at most 12)
+const int MAX_SYMMETRIES = 12;
+
+class SymmetryGroup;
+
+// Static description of a board shape: which holes exist and which jumps connect them
+class BoardGeometry {
+private:
+    int id;                              // small process-unique number, distinguishes geometries in shared tables
+    std::uint64_t fingerprint;           // stable across runs, distinguishes geometries on disk
+    int width, height;
+    std::vector<int> cellIndex;          // y * width + x -> cell, -1 if there is no hole
+    std::vector<Position> cellPositions; // cell -> (x, y)
+    BitMask validMask;
+    std::vector<Jump> jumps;             // every (from, over, to) triple, ordered by from-cell then direction
+    std::vector<std::uint64_t> zobristKeys; // per cell, seeded from the shape so every geometry hashes differently
+    std::shared_ptr<const SymmetryGroup> symmetries;
+    int symmetryCount;
+    std::vector<std::uint64_t> symmetricJumpHashes; // [move * symmetryCount + transform]
+
+public:
+    BoardGeometry(int w, int h, const std::function<bool(int, int)>& isHole,
+        const std::vector<std::pair<int, int>>& directions);
+    BoardGeometry(const BoardGeometry&) = delete;
+    BoardGeometry& operator=(const BoardGeometry&) = delete;
+
+    int getId() const { return id; }
+    std::uint64_t getFingerprint() const { return fingerprint; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getCellCount() const { return (int)cellPositions.size(); }
+    int getCellIndex(int x, int y) const {
+        if (x < 0 || y < 0 || x >= width || y >= height) return -1;
+        return cellIndex[y * width + x];
+    }
+    Position getCellPosition(int cell) const { return cellPositions[cell]; }
+    BitMask getValidMask() const { return validMask; }
+    int getJumpCount() const { return (int)jumps.size(); }
+    const Jump& getJump(MoveIndex index) const { return jumps[index]; }
+    // Index of the jump from (fromX, fromY) to (toX, toY), -1 if the geometry has no such jump
+    int findJump(int fromX, int fromY, int toX, int toY) const;
+    std::uint64_t getZobristKey(int cell) const { return zobristKeys[cell]; }
+    // Full Zobrist hash of a peg mask; BitBoard keeps it incrementally instead
+    std::uint64_t hashPegs(BitMask pegs) const;
+    const SymmetryGroup& getSymmetries() const { return *symmetries; }
+    int getSymmetryCount() const { return symmetryCount; }
+    // Hash change of `move` as seen through each symmetry, symmetryCount entries
+    const std::uint64_t* getSymmetricJumpHashes(MoveIndex move) const { return symmetricJumpHashes.data() + move * symmetryCount; }
+};
+
+// Peg occupancy of a geometry packed into a single word
+class BitBoard {
+private:
+    const BoardGeometry* geometry;
+    BitMask pegs;
+    std::uint64_t hashes[MAX_SYMMETRIES]; // hashes[t]: Zobrist hash of the image under symmetry t
+
+public:
+    BitBoard() : geometry(nullptr), pegs(0), hashes() {}
+    BitBoard(const BoardGeometry& g, BitMask p);
+
+    const BoardGeometry& getGeometry() const { return *geometry; }
+    BitMask getPegs() const { return pegs; }
+    std::uint64_t getHash() const { return hashes[0]; }
+    // Smallest hash over all symmetric images, shared by every position of a symmetry class.
+    // `transform` receives the symmetry that maps this position to its canonical representative.
+    std::uint64_t getCanonicalHash(int& transform) const {
+        transform = 0;
+        for (int t = 1; t < geometry->getSymmetryCount(); ++t) {
+            if (hashes[t] < hashes[transform]) transform = t;
+        }
+        return hashes[transform];
+    }
+    std::uint64_t getCanonicalHash() const { int transform; return getCanonicalHash(transform); }
+    BitMask getCanonicalPegs() const;
+    int getPegCount() const { return popCount(pegs); }
+    bool hasPeg(int cell) const { return (pegs & cellBit(cell)) != 0; }
+
+    bool canJump(const Jump& jump) const {
+        return (pegs & jump.mask) == (cellBit(jump.from) | cellBit(jump.over));
+    }
+    void makeMove(MoveIndex move) {
+        pegs ^= geometry->getJump(move).mask;
+        const std::uint64_t* delta = geometry->getSymmetricJumpHashes(move);
+        for (int t = 0; t < geometry->getSymmetryCount(); ++t) hashes[t] ^= delta[t];
+    }
+    void undoMove(MoveIndex move) { makeMove(move); }
+
+    // Scans the geometry's jump table against the current occupancy
+    void getAllPossibleMoves(MoveList& moves) const;
+};
+
+#endif // BITBOARD_H
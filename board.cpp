@@ -0,0 +1,286 @@
+#include "board.h"
+#include "ai_solver.h"
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+
+Board::Board(int w, int h) : width(w), height(h) {
+    grid.resize(height, vector<int>(width, -1));
+}
+Board::~Board() {}
+
+// Static score and history; killers did not help on the square or hexagon endgames we measured
+MoveOrdering Board::getMoveOrdering() const { return MoveOrdering{ true, true, 0 }; }
+void Board::clearBoardHistory() { moveHistory.clear(); }
+void Board::copyStateTo(Board& copy, bool withHistory) const {
+    copy.grid = grid;
+    if (withHistory) copy.moveHistory = moveHistory;
+    else copy.moveHistory.clear();
+}
+const vector<vector<int>>& Board::getGrid() const { return grid; }
+string Board::getStateHash() const {
+    string hash_str;
+    hash_str.reserve(width * height);
+    for (int y_idx = 0; y_idx < height; ++y_idx) {
+        for (int x_idx = 0; x_idx < width; ++x_idx) {
+            if (grid[y_idx][x_idx] != -1) {
+                hash_str += to_string(grid[y_idx][x_idx] + 1);
+            }
+        }
+    }
+    return hash_str;
+}
+bool Board::makeMove(const Move& move) {
+    if (!isValidMove(move)) return false;
+    moveHistory.push_back(move);
+    grid[move.from_y][move.from_x] = 0;
+    grid[move.over_y][move.over_x] = 0;
+    grid[move.to_y][move.to_x] = 1;
+    return true;
+}
+// A jump is only made from a peg over a peg into a hole, so those three cells are all it takes to revert it
+bool Board::undoMove() {
+    if (moveHistory.empty()) return false;
+    const Move& move = moveHistory.back();
+    grid[move.from_y][move.from_x] = 1;
+    grid[move.over_y][move.over_x] = 1;
+    grid[move.to_y][move.to_x] = 0;
+    moveHistory.pop_back();
+    return true;
+}
+void Board::resetBoard() {
+    moveHistory.clear();
+    initializeBoard();
+}
+bool Board::isValidMove(const Move& move) const {
+    if (!isValidPosition(move.from_x, move.from_y) ||
+        !isValidPosition(move.over_x, move.over_y) ||
+        !isValidPosition(move.to_x, move.to_y)) {
+        return false;
+    }
+    if (getPeg(move.from_x, move.from_y) != 1) return false;
+    if (getPeg(move.over_x, move.over_y) != 1) return false;
+    if (getPeg(move.to_x, move.to_y) != 0) return false;
+    int dx_total = move.to_x - move.from_x;
+    int dy_total = move.to_y - move.from_y;
+    if (dx_total == 0 && dy_total == 0) return false;
+    if (dx_total % 2 != 0 || dy_total % 2 != 0) return false;
+    if (move.over_x != (move.from_x + dx_total / 2) ||
+        move.over_y != (move.from_y + dy_total / 2)) {
+        return false;
+    }
+    return true;
+}
+int Board::getPegCount() const {
+    int count = 0;
+    for (const auto& row : grid) for (int cell : row) if (cell == 1) count++;
+    return count;
+}
+bool Board::isGameWon() const { return getPegCount() == 1; }
+bool Board::isGameLost() const { return getAllPossibleMoves().empty() && getPegCount() > 1; }
+void Board::setPeg(int x, int y, int value) { if (isValidPosition(x, y)) grid[y][x] = value; }
+int Board::getPeg(int x, int y) const { if (y >= 0 && y < height && x >= 0 && x < width) return grid[y][x]; return -1; }
+int Board::getWidth() const { return width; }
+int Board::getHeight() const { return height; }
+vector<Move> Board::getAllPossibleMoves() const {
+    MoveList legalMoves;
+    toBitBoard().getAllPossibleMoves(legalMoves);
+    vector<Move> moves;
+    moves.reserve(legalMoves.size);
+    for (MoveIndex index : legalMoves) moves.push_back(getMove(index));
+    return moves;
+}
+Move Board::getMove(MoveIndex index) const {
+    const BoardGeometry& geometry = getGeometry();
+    const Jump& jump = geometry.getJump(index);
+    Position from = geometry.getCellPosition(jump.from);
+    Position over = geometry.getCellPosition(jump.over);
+    Position to = geometry.getCellPosition(jump.to);
+    return Move(from.x, from.y, over.x, over.y, to.x, to.y);
+}
+BitBoard Board::toBitBoard() const {
+    const BoardGeometry& geometry = getGeometry();
+    BitMask pegs = 0;
+    for (int cell = 0; cell < geometry.getCellCount(); ++cell) {
+        Position p = geometry.getCellPosition(cell);
+        if (getPeg(p.x, p.y) == 1) pegs |= cellBit(cell);
+    }
+    return BitBoard(geometry, pegs);
+}
+
+TriangleBoard::TriangleBoard() : Board(5, 5) { initializeBoard(); }
+void TriangleBoard::initializeBoard() {
+    for (int y = 0; y < 5; y++)
+        for (int x = 0; x <= y; x++) {
+            grid[y][x] = 1;
+        }
+    grid[2][2] = 0;
+}
+bool TriangleBoard::isValidPosition(int x, int y) const {
+    return x >= 0 && x < width && y >= 0 && y < height && x <= y;
+}
+Position TriangleBoard::screenToBoard(int screenX, int screenY, int offsetX, int offsetY) const {
+    const int spacing = 60, pegSize = 25;
+    for (int y_coord = 0; y_coord < 5; y_coord++)
+        for (int x_coord = 0; x_coord <= y_coord; x_coord++) {
+            int boardScreenX = offsetX + x_coord * spacing + (4 - y_coord) * spacing / 2;
+            int boardScreenY = offsetY + y_coord * spacing;
+            if (hypot(screenX - boardScreenX, screenY - boardScreenY) <= pegSize + 5)
+                return Position(x_coord, y_coord);
+        }
+    return Position(-1, -1);
+}
+Position TriangleBoard::boardToScreen(int boardX, int boardY, int offsetX, int offsetY) const {
+    if (!isValidPosition(boardX, boardY)) return Position(-1, -1);
+    const int spacing = 60;
+    int screenX = offsetX + boardX * spacing + (4 - boardY) * spacing / 2;
+    int screenY = offsetY + boardY * spacing;
+    return Position(screenX, screenY);
+}
+const BoardGeometry& TriangleBoard::getGeometry() const {
+    static const BoardGeometry geometry(5, 5, [](int x, int y) { return x <= y; },
+        { {2,0}, {-2,0}, {0,2}, {0,-2}, {2,2}, {-2,-2} });
+    return geometry;
+}
+std::unique_ptr<Board> TriangleBoard::clone(bool withHistory) const {
+    auto copy = std::make_unique<TriangleBoard>();
+    copyStateTo(*copy, withHistory);
+    return copy;
+}
+
+SquareBoard::SquareBoard() : Board(7, 7) { initializeBoard(); }
+void SquareBoard::initializeBoard() {
+    for (int y = 0; y < 7; y++) for (int x = 0; x < 7; x++) {
+        if ((x >= 2 && x <= 4) || (y >= 2 && y <= 4)) grid[y][x] = 1; else grid[y][x] = -1;
+    }
+    grid[3][3] = 0;
+}
+bool SquareBoard::isValidPosition(int x, int y) const {
+    return x >= 0 && x < width && y >= 0 && y < height && ((x >= 2 && x <= 4) || (y >= 2 && y <= 4));
+}
+Position SquareBoard::screenToBoard(int screenX, int screenY, int offsetX, int offsetY) const {
+    const int spacing = 50, pegSize = 20;
+    for (int y_coord = 0; y_coord < 7; y_coord++)
+        for (int x_coord = 0; x_coord < 7; x_coord++) {
+            if (!isValidPosition(x_coord, y_coord)) continue;
+            int boardScreenX = offsetX + x_coord * spacing;
+            int boardScreenY = offsetY + y_coord * spacing;
+            if (hypot(screenX - boardScreenX, screenY - boardScreenY) <= pegSize + 5)
+                return Position(x_coord, y_coord);
+        }
+    return Position(-1, -1);
+}
+Position SquareBoard::boardToScreen(int boardX, int boardY, int offsetX, int offsetY) const {
+    if (!isValidPosition(boardX, boardY)) return Position(-1, -1);
+    const int spacing = 50;
+    int screenX = offsetX + boardX * spacing;
+    int screenY = offsetY + boardY * spacing;
+    return Position(screenX, screenY);
+}
+const BoardGeometry& SquareBoard::getGeometry() const {
+    static const BoardGeometry geometry(7, 7, [](int x, int y) { return (x >= 2 && x <= 4) || (y >= 2 && y <= 4); },
+        { {2,0}, {-2,0}, {0,2}, {0,-2} });
+    return geometry;
+}
+std::unique_ptr<Board> SquareBoard::clone(bool withHistory) const {
+    auto copy = std::make_unique<SquareBoard>();
+    copyStateTo(*copy, withHistory);
+    return copy;
+}
+
+// --- HexagonBoard Implementations ---
+HexagonBoard::HexagonBoard() : Board(9, 9) { initializeBoard(); }
+
+void HexagonBoard::initializeBoard() {
+    for (int y = 0; y < 9; ++y) {
+        for (int x = 0; x < 9; ++x) {
+            grid[y][x] = -1;
+        }
+    }
+    int validPositions[9][9] = {
+        {-1, -1, -1, -1,  1, -1, -1, -1, -1},  
+        {-1, -1, -1,  1,  1,  1, -1, -1, -1},  
+        {-1, -1,  1,  1,  1,  1,  1, -1, -1},  
+        {-1,  1,  1,  1,  1,  1,  1,  1, -1},  
+        { 1,  1,  1,  1,  0,  1,  1,  1,  1},  
+        {-1,  1,  1,  1,  1,  1,  1,  1, -1},  
+        {-1, -1,  1,  1,  1,  1,  1, -1, -1},  
+        {-1, -1, -1,  1,  1,  1, -1, -1, -1},  
+        {-1, -1, -1, -1,  1, -1, -1, -1, -1}   
+    };
+
+    for (int y = 0; y < 9; ++y) {
+        for (int x = 0; x < 9; ++x) {
+            grid[y][x] = validPositions[y][x];
+        }
+    }
+}
+
+bool HexagonBoard::isValidPosition(int x, int y) const {
+    if (x < 0 || y < 0 || x >= width || y >= height) return false;
+    return grid[y][x] != -1;
+}
+
+Position HexagonBoard::screenToBoard(int screenX, int screenY, int offsetX, int offsetY) const {
+    const int pegSize = 22;
+    const int cellSpacing = 55;
+
+    for (int y_coord = 0; y_coord < height; y_coord++) {
+        for (int x_coord = 0; x_coord < width; x_coord++) {
+            if (!isValidPosition(x_coord, y_coord)) continue;
+
+            int boardScreenX = offsetX + x_coord * cellSpacing;
+            int boardScreenY = offsetY + y_coord * cellSpacing;
+
+            if (hypot(screenX - boardScreenX, screenY - boardScreenY) <= pegSize + 5) {
+                return Position(x_coord, y_coord);
+            }
+        }
+    }
+    return Position(-1, -1);
+}
+
+Position HexagonBoard::boardToScreen(int boardX, int boardY, int offsetX, int offsetY) const {
+    if (!isValidPosition(boardX, boardY)) return Position(-1, -1);
+
+    const int cellSpacing = 55;
+    int screenX = offsetX + boardX * cellSpacing;
+    int screenY = offsetY + boardY * cellSpacing;
+
+    return Position(screenX, screenY);
+}
+
+const BoardGeometry& HexagonBoard::getGeometry() const {
+    // Holes of validPositions in initializeBoard; odd directions never form a jump and are dropped
+    static const BoardGeometry geometry(9, 9, [](int x, int y) { return abs(x - 4) + abs(y - 4) <= 4; },
+        { {2, 0}, {-2, 0}, {0, 2}, {0, -2}, {1, 1}, {-1, -1}, {1, -1}, {-1, 1} });
+    return geometry;
+}
+
+std::unique_ptr<Board> HexagonBoard::clone(bool withHistory) const {
+    auto copy = std::make_unique<HexagonBoard>();
+    copyStateTo(*copy, withHistory);
+    return copy;
+}
+
+unique_ptr<Board> makeBoard(const string& name) {
+    if (name == "triangle") return make_unique<TriangleBoard>();
+    if (name == "square") return make_unique<SquareBoard>();
+    if (name == "hexagon") return make_unique<HexagonBoard>();
+    return nullptr;
+}
+
+bool setCells(Board& board, const string& cells) {
+    if (cells == "start") return true;
+    const BoardGeometry& geometry = board.getGeometry();
+    if ((int)cells.size() != geometry.getCellCount()) return false;
+    for (int cell = 0; cell < geometry.getCellCount(); ++cell) {
+        Position p = geometry.getCellPosition(cell);
+        char c = cells[cell];
+        if (c == '1' || c == 'x') board.setPeg(p.x, p.y, 1);
+        else if (c == '0' || c == '.') board.setPeg(p.x, p.y, 0);
+        else return false;
+    }
+    return true;
+}
@@ -6,24 +6,21 @@
 #include <string>
 #include <cmath>
 #include <memory> // [MODIFIED] Added for std::unique_ptr
+#include "bitboard.h"
+#include "move_ordering.h"
 
 // Forward-declare the Move struct, as Board methods use it
 struct Move;
 
-// Struct for a position on the board
-struct Position {
-    int x, y;
-    Position(int px = -1, int py = -1) : x(px), y(py) {}
-    bool operator==(const Position& other) const { return x == other.x && y == other.y; }
-};
-
 // Abstract base class Board
 class Board {
 protected:
     int width, height;
     std::vector<std::vector<int>> grid;
-    std::vector<Move> moveHistory;
-    std::vector<std::vector<std::vector<int>>> boardHistory;
+    std::vector<Move> moveHistory; // moves since the start of the undo history; undo reverts them one by one
+
+    // For clone(): the grid, and the undo history if asked for
+    void copyStateTo(Board& copy, bool withHistory) const;
 
 public:
     Board(int w, int h);
@@ -32,17 +29,20 @@ public:
     // Pure virtual functions, must be implemented by derived classes
     virtual void initializeBoard() = 0;
     virtual bool isValidPosition(int x, int y) const = 0;
-    virtual std::vector<Move> getAllPossibleMoves() const = 0;
-    virtual void drawBoard(int offsetX = 100, int offsetY = 150) const = 0;
+    virtual std::vector<Move> getAllPossibleMoves() const;
     virtual Position screenToBoard(int screenX, int screenY, int offsetX = 100, int offsetY = 150) const = 0;
     virtual Position boardToScreen(int boardX, int boardY, int offsetX = 100, int offsetY = 150) const = 0;
+    virtual const BoardGeometry& getGeometry() const = 0;
+    // Move ordering the solver uses on this board type
+    virtual MoveOrdering getMoveOrdering() const;
 
     // [MODIFIED] The return type of clone() is now std::unique_ptr<Board>
-    virtual std::unique_ptr<Board> clone() const = 0;
+    // Without history the copy is just the position, cheap enough for searches
+    virtual std::unique_ptr<Board> clone(bool withHistory = true) const = 0;
 
     // Common methods implemented in the base class
+    // The current position becomes the start of the undo history
     void clearBoardHistory();
-    void addToBoardHistory(const std::vector<std::vector<int>>& state);
     const std::vector<std::vector<int>>& getGrid() const;
     std::string getStateHash() const;
     bool makeMove(const Move& move);
@@ -56,6 +56,8 @@ public:
     int getPeg(int x, int y) const;
     int getWidth() const;
     int getHeight() const;
+    BitBoard toBitBoard() const;
+    Move getMove(MoveIndex index) const;
 };
 
 // TriangleBoard class declaration
@@ -64,13 +66,12 @@ public:
     TriangleBoard();
     void initializeBoard() override;
     bool isValidPosition(int x, int y) const override;
-    std::vector<Move> getAllPossibleMoves() const override;
-    void drawBoard(int offsetX = 100, int offsetY = 150) const override;
     Position screenToBoard(int screenX, int screenY, int offsetX = 100, int offsetY = 150) const override;
     Position boardToScreen(int boardX, int boardY, int offsetX = 100, int offsetY = 150) const override;
+    const BoardGeometry& getGeometry() const override;
 
     // [MODIFIED] The override matches the base class change
-    std::unique_ptr<Board> clone() const override;
+    std::unique_ptr<Board> clone(bool withHistory = true) const override;
 };
 
 // SquareBoard class declaration
@@ -79,13 +80,12 @@ public:
     SquareBoard();
     void initializeBoard() override;
     bool isValidPosition(int x, int y) const override;
-    std::vector<Move> getAllPossibleMoves() const override;
-    void drawBoard(int offsetX = 100, int offsetY = 150) const override;
     Position screenToBoard(int screenX, int screenY, int offsetX = 100, int offsetY = 150) const override;
     Position boardToScreen(int boardX, int boardY, int offsetX = 100, int offsetY = 150) const override;
+    const BoardGeometry& getGeometry() const override;
 
     // [MODIFIED] The override matches the base class change
-    std::unique_ptr<Board> clone() const override;
+    std::unique_ptr<Board> clone(bool withHistory = true) const override;
 };
 
 // HexagonBoard class declaration
@@ -94,13 +94,18 @@ public:
     HexagonBoard();
     void initializeBoard() override;
     bool isValidPosition(int x, int y) const override;
-    std::vector<Move> getAllPossibleMoves() const override;
-    void drawBoard(int offsetX = 100, int offsetY = 150) const override;
     Position screenToBoard(int screenX, int screenY, int offsetX = 100, int offsetY = 150) const override;
     Position boardToScreen(int boardX, int boardY, int offsetX = 100, int offsetY = 150) const override;
+    const BoardGeometry& getGeometry() const override;
 
     // [MODIFIED] The override matches the base class change
-    std::unique_ptr<Board> clone() const override;
+    std::unique_ptr<Board> clone(bool withHistory = true) const override;
 };
 
+// For the command-line tools: "triangle", "square" or "hexagon", nullptr for any other name
+std::unique_ptr<Board> makeBoard(const std::string& name);
+// Fills the board's holes from a cell string, one character per hole in cell order ('1' or 'x'
+// a peg, '0' or '.' empty); "start" keeps the opening. False if it does not fit the board.
+bool setCells(Board& board, const std::string& cells);
+
 #endif // BOARD_H
\ No newline at end of file
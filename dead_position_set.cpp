@@ -0,0 +1,110 @@
+#include "dead_position_set.h"
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+using namespace std;
+
+// Low bits of a word: 1 + floor(log2) of the nodes it took to prove the position dead, so no
+// stored word is 0; the high bits are the position's key
+static const uint64_t WORK_BITS = 0x3F;
+
+static uint64_t workBits(long long work) {
+    uint64_t log = 0;
+    while (log < WORK_BITS - 1 && (work >> (log + 1)) > 0) ++log;
+    return log + 1;
+}
+
+DeadPositionSet::DeadPositionSet(size_t megabytes) {
+    size_t count = 1;
+    while (count * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024) count *= 2;
+    buckets.reset(new Bucket[count]);
+    bucketMask = count - 1;
+    clear();
+}
+
+DeadPositionSet& DeadPositionSet::shared() {
+    static DeadPositionSet set;
+    return set;
+}
+
+DeadPositionSet::CounterShard& DeadPositionSet::localCounters() const {
+    static thread_local size_t shard = hash<thread::id>()(this_thread::get_id()) % COUNTER_SHARDS;
+    return counters[shard];
+}
+
+// The mask verification mode compares: the key hashes the canonical pegs without a finish hole
+static BitMask pegsOf(const BitBoard& board, int finish) {
+    return finish < 0 ? board.getCanonicalPegs() : board.getPegs();
+}
+
+uint64_t DeadPositionSet::keyOf(const BitBoard& board, int target, int finish) {
+    uint64_t salt = ((uint64_t)board.getGeometry().getId() << 16 | (uint64_t)((finish + 1) & 0xFF) << 8 | (uint64_t)(target & 0xFF)) * 0x9E3779B97F4A7C15ULL;
+    uint64_t hash = finish < 0 ? board.getCanonicalHash() : board.getHash();
+    uint64_t key = ((hash ^ salt) + (uint64_t)board.getPegCount()) & ~WORK_BITS;
+    return key ? key : ~WORK_BITS; // 0 is the empty word
+}
+
+bool DeadPositionSet::contains(const BitBoard& board, int target, int finish) const {
+    uint64_t key = keyOf(board, target, finish);
+    size_t index = (key >> 6) & bucketMask;
+    const Bucket& bucket = buckets[index];
+    for (int i = 0; i < BUCKET_KEYS; ++i) {
+        uint64_t word = bucket.keys[i].load(memory_order_relaxed);
+        if ((word & ~WORK_BITS) != key) continue;
+        if (!checks || (checks[index * BUCKET_KEYS + i].load(memory_order_relaxed) ^ word) == pegsOf(board, finish)) return true;
+        localCounters().collisions.fetch_add(1, memory_order_relaxed);
+    }
+    return false;
+}
+
+void DeadPositionSet::insert(const BitBoard& board, int target, int finish, long long work) {
+    uint64_t key = keyOf(board, target, finish);
+    size_t index = (key >> 6) & bucketMask;
+    Bucket& bucket = buckets[index];
+    BitMask pegs = checks ? pegsOf(board, finish) : 0;
+    int victim = -1;
+    uint64_t victimWork = WORK_BITS + 1;
+    for (int i = 0; i < BUCKET_KEYS; ++i) {
+        uint64_t old = bucket.keys[i].load(memory_order_relaxed);
+        if ((old & ~WORK_BITS) == key &&
+            (!checks || (checks[index * BUCKET_KEYS + i].load(memory_order_relaxed) ^ old) == pegs)) return;
+        uint64_t oldWork = old & WORK_BITS;
+        if (oldWork < victimWork) { victim = i; victimWork = oldWork; }
+    }
+    // The newest proof always goes in, over the cheapest one: a position the search just left is
+    // the likeliest to be met again, and refusing it would leave a full table with stale entries
+    uint64_t word = key | workBits(work);
+    if (checks) checks[index * BUCKET_KEYS + victim].store(pegs ^ word, memory_order_relaxed);
+    bucket.keys[victim].store(word, memory_order_relaxed);
+    if (victimWork == 0) localCounters().fills.fetch_add(1, memory_order_relaxed);
+}
+
+void DeadPositionSet::setVerification(bool enabled) {
+    if (enabled == isVerifying()) return;
+    checks.reset(enabled ? new atomic<uint64_t>[capacity()] : nullptr);
+    clear();
+}
+
+long long DeadPositionSet::collisions() const {
+    long long count = 0;
+    for (const CounterShard& shard : counters) count += shard.collisions.load(memory_order_relaxed);
+    return count;
+}
+
+void DeadPositionSet::clear() {
+    for (size_t i = 0; i <= bucketMask; ++i) {
+        for (auto& slot : buckets[i].keys) slot.store(0, memory_order_relaxed);
+    }
+    if (checks) {
+        for (size_t i = 0; i < capacity(); ++i) checks[i].store(0, memory_order_relaxed);
+    }
+    for (CounterShard& shard : counters) shard.fills.store(0, memory_order_relaxed);
+}
+
+size_t DeadPositionSet::size() const {
+    long long count = 0;
+    for (const CounterShard& shard : counters) count += shard.fills.load(memory_order_relaxed);
+    // Two threads filling the same empty word at once both count it
+    return (std::min)((size_t)count, capacity());
+}
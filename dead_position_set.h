@@ -0,0 +1,65 @@
+// dead_position_set.h
+#ifndef DEAD_POSITION_SET_H
+#define DEAD_POSITION_SET_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "bitboard.h"
+
+// Positions proven unsolvable, shared by every solver thread of the depth-first search.
+// One 64-bit word per position: its canonical hash, salted with the geometry, target and peg
+// count, with the log of the nodes its proof took in the low bits. The set never grows; buckets
+// are one cache line of eight words, and a full bucket evicts the position that was cheapest
+// to prove, so a set too small for the search costs re-proofs of small subtrees only.
+// Words are written without locks; a lost insert only costs a second proof.
+class DeadPositionSet {
+public:
+    explicit DeadPositionSet(std::size_t megabytes = 32);
+
+    // The process-wide set used by every AISolver unless another one is set
+    static DeadPositionSet& shared();
+
+    // `target` is the solver's max_pegs_to_solve and `finish` the hole its last peg has to end in,
+    // -1 = any; positions only match the same target, finish and geometry. With a finish hole a
+    // position no longer stands for its symmetric images, which aim at other holes.
+    bool contains(const BitBoard& board, int target, int finish = -1) const;
+    // `work`: nodes searched to prove the position dead
+    void insert(const BitBoard& board, int target, int finish = -1, long long work = 1);
+    void clear();
+    // Verification mode also keeps every position's peg mask, canonical unless a finish hole is
+    // set, and only matches positions with the same mask; a second word per position.
+    // Switching modes clears the set, so it is not to be done while a search uses it.
+    void setVerification(bool enabled);
+    bool isVerifying() const { return checks != nullptr; }
+    // Verification mode: lookups whose key matched a position with other pegs
+    long long collisions() const;
+    // Positions held
+    std::size_t size() const;
+    std::size_t capacity() const { return (bucketMask + 1) * BUCKET_KEYS; }
+    std::size_t bytes() const { return (bucketMask + 1) * sizeof(Bucket) + (checks ? capacity() * sizeof(std::uint64_t) : 0); }
+
+private:
+    static const int BUCKET_KEYS = 8;
+    struct alignas(64) Bucket {
+        std::atomic<std::uint64_t> keys[BUCKET_KEYS];
+    };
+
+    struct alignas(64) CounterShard {
+        std::atomic<long long> fills{ 0 }; // inserts into an empty word
+        std::atomic<long long> collisions{ 0 };
+    };
+    static const int COUNTER_SHARDS = 16;
+
+    std::unique_ptr<Bucket[]> buckets;
+    std::size_t bucketMask;
+    // Verification mode: peg mask ^ word for every word, so a torn pair fails the check
+    std::unique_ptr<std::atomic<std::uint64_t>[]> checks;
+    mutable CounterShard counters[COUNTER_SHARDS];
+
+    CounterShard& localCounters() const;
+    static std::uint64_t keyOf(const BitBoard& board, int target, int finish);
+};
+
+#endif // DEAD_POSITION_SET_H
@@ -45,106 +45,8 @@
 using namespace std;
 
 
-map<string, vector<Move>> solutionCache;
-
-Board::Board(int w, int h) : width(w), height(h) {
-    grid.resize(height, vector<int>(width, -1));
-    boardHistory.push_back(grid);
-}
-Board::~Board() {}
-void Board::clearBoardHistory() { boardHistory.clear(); }
-void Board::addToBoardHistory(const vector<vector<int>>& state) { boardHistory.push_back(state); }
-const vector<vector<int>>& Board::getGrid() const { return grid; }
-string Board::getStateHash() const {
-    string hash_str;
-    hash_str.reserve(width * height);
-    for (int y_idx = 0; y_idx < height; ++y_idx) {
-        for (int x_idx = 0; x_idx < width; ++x_idx) {
-            if (grid[y_idx][x_idx] != -1) {
-                hash_str += to_string(grid[y_idx][x_idx] + 1);
-            }
-        }
-    }
-    return hash_str;
-}
-bool Board::makeMove(const Move& move) {
-    if (!isValidMove(move)) return false;
-    boardHistory.push_back(grid);
-    moveHistory.push_back(move);
-    grid[move.from_y][move.from_x] = 0;
-    grid[move.over_y][move.over_x] = 0;
-    grid[move.to_y][move.to_x] = 1;
-    return true;
-}
-bool Board::undoMove() {
-    if (boardHistory.size() <= 1) return false;
-    grid = boardHistory.back();
-    boardHistory.pop_back();
-    if (!moveHistory.empty()) moveHistory.pop_back();
-    return true;
-}
-void Board::resetBoard() {
-    moveHistory.clear();
-    boardHistory.clear();
-    initializeBoard();
-    boardHistory.push_back(grid);
-}
-bool Board::isValidMove(const Move& move) const {
-    if (!isValidPosition(move.from_x, move.from_y) ||
-        !isValidPosition(move.over_x, move.over_y) ||
-        !isValidPosition(move.to_x, move.to_y)) {
-        return false;
-    }
-    if (getPeg(move.from_x, move.from_y) != 1) return false;
-    if (getPeg(move.over_x, move.over_y) != 1) return false;
-    if (getPeg(move.to_x, move.to_y) != 0) return false;
-    int dx_total = move.to_x - move.from_x;
-    int dy_total = move.to_y - move.from_y;
-    if (dx_total == 0 && dy_total == 0) return false;
-    if (dx_total % 2 != 0 || dy_total % 2 != 0) return false;
-    if (move.over_x != (move.from_x + dx_total / 2) ||
-        move.over_y != (move.from_y + dy_total / 2)) {
-        return false;
-    }
-    return true;
-}
-int Board::getPegCount() const {
-    int count = 0;
-    for (const auto& row : grid) for (int cell : row) if (cell == 1) count++;
-    return count;
-}
-bool Board::isGameWon() const { return getPegCount() == 1; }
-bool Board::isGameLost() const { return getAllPossibleMoves().empty() && getPegCount() > 1; }
-void Board::setPeg(int x, int y, int value) { if (isValidPosition(x, y)) grid[y][x] = value; }
-int Board::getPeg(int x, int y) const { if (y >= 0 && y < height && x >= 0 && x < width) return grid[y][x]; return -1; }
-int Board::getWidth() const { return width; }
-int Board::getHeight() const { return height; }
-
-TriangleBoard::TriangleBoard() : Board(5, 5) { initializeBoard(); }
-void TriangleBoard::initializeBoard() {
-    for (int y = 0; y < 5; y++)
-        for (int x = 0; x <= y; x++) {
-            grid[y][x] = 1;
-        }
-    grid[2][2] = 0;
-}
-bool TriangleBoard::isValidPosition(int x, int y) const {
-    return x >= 0 && x < width && y >= 0 && y < height && x <= y;
-}
-vector<Move> TriangleBoard::getAllPossibleMoves() const {
-    vector<Move> moves;
-    for (int y_coord = 0; y_coord < height; y_coord++)
-        for (int x_coord = 0; x_coord < width; x_coord++) {
-            if (getPeg(x_coord, y_coord) != 1) continue;
-            vector<pair<int, int>> directions = { {2,0}, {-2,0}, {0,2}, {0,-2}, {2,2}, {-2,-2} };
-            for (auto& dir : directions) {
-                Move move(x_coord, y_coord, x_coord + dir.first / 2, y_coord + dir.second / 2, x_coord + dir.first, y_coord + dir.second);
-                if (Board::isValidMove(move)) moves.push_back(move);
-            }
-        }
-    return moves;
-}
-void TriangleBoard::drawBoard(int offsetX, int offsetY) const {
+// Board rendering lives with the GUI so the rules in board.cpp build without EasyX
+static void drawTriangleBoard(const TriangleBoard& board, int offsetX, int offsetY) {
     const int pegSize = 25, spacing = 60;
     for (int y_coord = 0; y_coord < 5; y_coord++)
         for (int x_coord = 0; x_coord <= y_coord; x_coord++) {
@@ -152,7 +54,7 @@ void TriangleBoard::drawBoard(int offsetX, int offsetY) const {
             int screenY = offsetY + y_coord * spacing;
             setfillcolor(RGB(139, 69, 19));
             fillcircle(screenX, screenY, pegSize + 3);
-            if (getPeg(x_coord, y_coord) == 1) {
+            if (board.getPeg(x_coord, y_coord) == 1) {
                 for (int r = pegSize; r >= 0; r -= 2) {
                     float ratio = (float)r / pegSize;
                     COLORREF color = RGB((int)(255 * (0.8f + 0.2f * ratio)), (int)(215 * (0.8f + 0.2f * ratio)), (int)(0 * (0.8f + 0.2f * ratio)));
@@ -164,7 +66,7 @@ void TriangleBoard::drawBoard(int offsetX, int offsetY) const {
                 setcolor(RGB(184, 134, 11));
                 circle(screenX, screenY, pegSize);
             }
-            else if (getPeg(x_coord, y_coord) == 0) {
+            else if (board.getPeg(x_coord, y_coord) == 0) {
                 setfillcolor(RGB(101, 67, 33));
                 fillcircle(screenX, screenY, pegSize);
                 setfillcolor(RGB(80, 50, 20));
@@ -172,61 +74,16 @@ void TriangleBoard::drawBoard(int offsetX, int offsetY) const {
             }
         }
 }
-Position TriangleBoard::screenToBoard(int screenX, int screenY, int offsetX, int offsetY) const {
-    const int spacing = 60, pegSize = 25;
-    for (int y_coord = 0; y_coord < 5; y_coord++)
-        for (int x_coord = 0; x_coord <= y_coord; x_coord++) {
-            int boardScreenX = offsetX + x_coord * spacing + (4 - y_coord) * spacing / 2;
-            int boardScreenY = offsetY + y_coord * spacing;
-            if (hypot(screenX - boardScreenX, screenY - boardScreenY) <= pegSize + 5)
-                return Position(x_coord, y_coord);
-        }
-    return Position(-1, -1);
-}
-Position TriangleBoard::boardToScreen(int boardX, int boardY, int offsetX, int offsetY) const {
-    if (!isValidPosition(boardX, boardY)) return Position(-1, -1);
-    const int spacing = 60;
-    int screenX = offsetX + boardX * spacing + (4 - boardY) * spacing / 2;
-    int screenY = offsetY + boardY * spacing;
-    return Position(screenX, screenY);
-}
-std::unique_ptr<Board> TriangleBoard::clone() const {
-    return std::make_unique<TriangleBoard>(*this);
-}
-
-SquareBoard::SquareBoard() : Board(7, 7) { initializeBoard(); }
-void SquareBoard::initializeBoard() {
-    for (int y = 0; y < 7; y++) for (int x = 0; x < 7; x++) {
-        if ((x >= 2 && x <= 4) || (y >= 2 && y <= 4)) grid[y][x] = 1; else grid[y][x] = -1;
-    }
-    grid[3][3] = 0;
-}
-bool SquareBoard::isValidPosition(int x, int y) const {
-    return x >= 0 && x < width && y >= 0 && y < height && ((x >= 2 && x <= 4) || (y >= 2 && y <= 4));
-}
-vector<Move> SquareBoard::getAllPossibleMoves() const {
-    vector<Move> moves;
-    for (int y_coord = 0; y_coord < height; y_coord++)
-        for (int x_coord = 0; x_coord < width; x_coord++) {
-            if (getPeg(x_coord, y_coord) != 1) continue;
-            vector<pair<int, int>> directions = { {2,0}, {-2,0}, {0,2}, {0,-2} };
-            for (auto& dir : directions) {
-                Move move(x_coord, y_coord, x_coord + dir.first / 2, y_coord + dir.second / 2, x_coord + dir.first, y_coord + dir.second);
-                if (Board::isValidMove(move)) moves.push_back(move);
-            }
-        }
-    return moves;
-}
-void SquareBoard::drawBoard(int offsetX, int offsetY) const {
+static void drawSquareBoard(const SquareBoard& board, int offsetX, int offsetY) {
     const int pegSize = 20, spacing = 50;
     for (int y_coord = 0; y_coord < 7; y_coord++)
         for (int x_coord = 0; x_coord < 7; x_coord++) {
-            if (!isValidPosition(x_coord, y_coord)) continue;
+            if (!board.isValidPosition(x_coord, y_coord)) continue;
             int screenX = offsetX + x_coord * spacing;
             int screenY = offsetY + y_coord * spacing;
             setfillcolor(RGB(139, 69, 19));
             fillcircle(screenX, screenY, pegSize + 2);
-            if (getPeg(x_coord, y_coord) == 1) {
+            if (board.getPeg(x_coord, y_coord) == 1) {
                 for (int r = pegSize; r >= 0; r -= 1) {
                     float ratio = (float)r / pegSize;
                     COLORREF color = RGB((int)(255 * (0.8f + 0.2f * ratio)), (int)(215 * (0.8f + 0.2f * ratio)), 0);
@@ -238,7 +95,7 @@ void SquareBoard::drawBoard(int offsetX, int offsetY) const {
                 setcolor(RGB(184, 134, 11));
                 circle(screenX, screenY, pegSize);
             }
-            else if (getPeg(x_coord, y_coord) == 0) {
+            else if (board.getPeg(x_coord, y_coord) == 0) {
                 setfillcolor(RGB(101, 67, 33));
                 fillcircle(screenX, screenY, pegSize);
                 setfillcolor(RGB(80, 50, 20));
@@ -246,95 +103,15 @@ void SquareBoard::drawBoard(int offsetX, int offsetY) const {
             }
         }
 }
-Position SquareBoard::screenToBoard(int screenX, int screenY, int offsetX, int offsetY) const {
-    const int spacing = 50, pegSize = 20;
-    for (int y_coord = 0; y_coord < 7; y_coord++)
-        for (int x_coord = 0; x_coord < 7; x_coord++) {
-            if (!isValidPosition(x_coord, y_coord)) continue;
-            int boardScreenX = offsetX + x_coord * spacing;
-            int boardScreenY = offsetY + y_coord * spacing;
-            if (hypot(screenX - boardScreenX, screenY - boardScreenY) <= pegSize + 5)
-                return Position(x_coord, y_coord);
-        }
-    return Position(-1, -1);
-}
-Position SquareBoard::boardToScreen(int boardX, int boardY, int offsetX, int offsetY) const {
-    if (!isValidPosition(boardX, boardY)) return Position(-1, -1);
-    const int spacing = 50;
-    int screenX = offsetX + boardX * spacing;
-    int screenY = offsetY + boardY * spacing;
-    return Position(screenX, screenY);
-}
-std::unique_ptr<Board> SquareBoard::clone() const {
-    return std::make_unique<SquareBoard>(*this);
-}
-
-// --- HexagonBoard Implementations ---
-HexagonBoard::HexagonBoard() : Board(9, 9) { initializeBoard(); }
-
-void HexagonBoard::initializeBoard() {
-    for (int y = 0; y < 9; ++y) {
-        for (int x = 0; x < 9; ++x) {
-            grid[y][x] = -1;
-        }
-    }
-    int validPositions[9][9] = {
-        {-1, -1, -1, -1,  1, -1, -1, -1, -1},  
-        {-1, -1, -1,  1,  1,  1, -1, -1, -1},  
-        {-1, -1,  1,  1,  1,  1,  1, -1, -1},  
-        {-1,  1,  1,  1,  1,  1,  1,  1, -1},  
-        { 1,  1,  1,  1,  0,  1,  1,  1,  1},  
-        {-1,  1,  1,  1,  1,  1,  1,  1, -1},  
-        {-1, -1,  1,  1,  1,  1,  1, -1, -1},  
-        {-1, -1, -1,  1,  1,  1, -1, -1, -1},  
-        {-1, -1, -1, -1,  1, -1, -1, -1, -1}   
-    };
-
-    for (int y = 0; y < 9; ++y) {
-        for (int x = 0; x < 9; ++x) {
-            grid[y][x] = validPositions[y][x];
-        }
-    }
-}
-
-bool HexagonBoard::isValidPosition(int x, int y) const {
-    if (x < 0 || y < 0 || x >= width || y >= height) return false;
-    return grid[y][x] != -1;
-}
-
-vector<Move> HexagonBoard::getAllPossibleMoves() const {
-    vector<Move> moves;
-    for (int y_coord = 0; y_coord < height; y_coord++) {
-        for (int x_coord = 0; x_coord < width; x_coord++) {
-            if (getPeg(x_coord, y_coord) != 1) continue;
-
-            int directions[][2] = {
-                {2, 0}, {-2, 0},    
-                {0, 2}, {0, -2},    
-                {1, 1}, {-1, -1},   
-                {1, -1}, {-1, 1}    
-            };
-
-            for (auto& dir : directions) {
-                Move move(x_coord, y_coord,
-                    x_coord + dir[0] / 2, y_coord + dir[1] / 2,
-                    x_coord + dir[0], y_coord + dir[1]);
-                if (Board::isValidMove(move)) moves.push_back(move);
-            }
-        }
-    }
-    return moves;
-}
-
-void HexagonBoard::drawBoard(int offsetX, int offsetY) const {
+static void drawHexagonBoard(const HexagonBoard& board, int offsetX, int offsetY) {
     const int pegSize = 22;  
     const int cellSpacing = 55; 
     setfillcolor(RGB(160, 82, 45));  
     fillroundrect(offsetX - 50, offsetY - 50, offsetX + 450, offsetY + 450, 20, 20);
 
-    for (int y_coord = 0; y_coord < height; y_coord++) {
-        for (int x_coord = 0; x_coord < width; x_coord++) {
-            if (!isValidPosition(x_coord, y_coord)) continue;
+    for (int y_coord = 0; y_coord < board.getHeight(); y_coord++) {
+        for (int x_coord = 0; x_coord < board.getWidth(); x_coord++) {
+            if (!board.isValidPosition(x_coord, y_coord)) continue;
 
             int screenX = offsetX + x_coord * cellSpacing;
             int screenY = offsetY + y_coord * cellSpacing;
@@ -342,7 +119,7 @@ void HexagonBoard::drawBoard(int offsetX, int offsetY) const {
             setfillcolor(RGB(139, 69, 19));
             fillcircle(screenX, screenY, pegSize + 3);
 
-            if (getPeg(x_coord, y_coord) == 1) {
+            if (board.getPeg(x_coord, y_coord) == 1) {
                 for (int r = pegSize; r >= 0; r -= 1) {
                     float ratio = (float)r / pegSize;
                     COLORREF color = RGB(
@@ -358,7 +135,7 @@ void HexagonBoard::drawBoard(int offsetX, int offsetY) const {
                 setcolor(RGB(184, 134, 11));
                 circle(screenX, screenY, pegSize);
             }
-            else if (getPeg(x_coord, y_coord) == 0) {
+            else if (board.getPeg(x_coord, y_coord) == 0) {
                 setfillcolor(RGB(101, 67, 33));
                 fillcircle(screenX, screenY, pegSize);
                 setfillcolor(RGB(80, 50, 20));
@@ -370,9 +147,9 @@ void HexagonBoard::drawBoard(int offsetX, int offsetY) const {
     setcolor(RGB(101, 67, 33));
     setlinestyle(PS_SOLID, 2);
 
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width - 1; x++) {
-            if (isValidPosition(x, y) && isValidPosition(x + 1, y)) {
+    for (int y = 0; y < board.getHeight(); y++) {
+        for (int x = 0; x < board.getWidth() - 1; x++) {
+            if (board.isValidPosition(x, y) && board.isValidPosition(x + 1, y)) {
                 int x1 = offsetX + x * cellSpacing + pegSize;
                 int y1 = offsetY + y * cellSpacing;
                 int x2 = offsetX + (x + 1) * cellSpacing - pegSize;
@@ -382,9 +159,9 @@ void HexagonBoard::drawBoard(int offsetX, int offsetY) const {
         }
     }
 
-    for (int y = 0; y < height - 1; y++) {
-        for (int x = 0; x < width; x++) {
-            if (isValidPosition(x, y) && isValidPosition(x, y + 1)) {
+    for (int y = 0; y < board.getHeight() - 1; y++) {
+        for (int x = 0; x < board.getWidth(); x++) {
+            if (board.isValidPosition(x, y) && board.isValidPosition(x, y + 1)) {
                 int x1 = offsetX + x * cellSpacing;
                 int y1 = offsetY + y * cellSpacing + pegSize;
                 int x2 = x1;
@@ -393,16 +170,16 @@ void HexagonBoard::drawBoard(int offsetX, int offsetY) const {
             }
         }
     }
-    for (int y = 0; y < height - 1; y++) {
-        for (int x = 0; x < width - 1; x++) {
-            if (isValidPosition(x, y) && isValidPosition(x + 1, y + 1)) {
+    for (int y = 0; y < board.getHeight() - 1; y++) {
+        for (int x = 0; x < board.getWidth() - 1; x++) {
+            if (board.isValidPosition(x, y) && board.isValidPosition(x + 1, y + 1)) {
                 int x1 = offsetX + x * cellSpacing + pegSize / 1.4;
                 int y1 = offsetY + y * cellSpacing + pegSize / 1.4;
                 int x2 = offsetX + (x + 1) * cellSpacing - pegSize / 1.4;
                 int y2 = offsetY + (y + 1) * cellSpacing - pegSize / 1.4;
                 line(x1, y1, x2, y2);
             }
-            if (x + 1 < width && isValidPosition(x + 1, y) && isValidPosition(x, y + 1)) {
+            if (x + 1 < board.getWidth() && board.isValidPosition(x + 1, y) && board.isValidPosition(x, y + 1)) {
                 int x1 = offsetX + (x + 1) * cellSpacing - pegSize / 1.4;
                 int y1 = offsetY + y * cellSpacing + pegSize / 1.4;
                 int x2 = offsetX + x * cellSpacing + pegSize / 1.4;
@@ -412,38 +189,10 @@ void HexagonBoard::drawBoard(int offsetX, int offsetY) const {
         }
     }
 }
-
-Position HexagonBoard::screenToBoard(int screenX, int screenY, int offsetX, int offsetY) const {
-    const int pegSize = 22;
-    const int cellSpacing = 55;
-
-    for (int y_coord = 0; y_coord < height; y_coord++) {
-        for (int x_coord = 0; x_coord < width; x_coord++) {
-            if (!isValidPosition(x_coord, y_coord)) continue;
-
-            int boardScreenX = offsetX + x_coord * cellSpacing;
-            int boardScreenY = offsetY + y_coord * cellSpacing;
-
-            if (hypot(screenX - boardScreenX, screenY - boardScreenY) <= pegSize + 5) {
-                return Position(x_coord, y_coord);
-            }
-        }
-    }
-    return Position(-1, -1);
-}
-
-Position HexagonBoard::boardToScreen(int boardX, int boardY, int offsetX, int offsetY) const {
-    if (!isValidPosition(boardX, boardY)) return Position(-1, -1);
-
-    const int cellSpacing = 55;
-    int screenX = offsetX + boardX * cellSpacing;
-    int screenY = offsetY + boardY * cellSpacing;
-
-    return Position(screenX, screenY);
-}
-
-std::unique_ptr<Board> HexagonBoard::clone() const {
-    return std::make_unique<HexagonBoard>(*this);
+void drawBoard(const Board& board, int offsetX = 100, int offsetY = 150) {
+    if (auto triangle = dynamic_cast<const TriangleBoard*>(&board)) drawTriangleBoard(*triangle, offsetX, offsetY);
+    else if (auto square = dynamic_cast<const SquareBoard*>(&board)) drawSquareBoard(*square, offsetX, offsetY);
+    else if (auto hexagon = dynamic_cast<const HexagonBoard*>(&board)) drawHexagonBoard(*hexagon, offsetX, offsetY);
 }
 
 std::wstring StringToWstring(const std::string& str) {
@@ -660,7 +409,8 @@ private:
     chrono::high_resolution_clock::time_point lastFrameTime;
     bool isSolving = false;
     float solveProgress = 0.0f;
-    std::shared_ptr<AISolver> solver_instance;
+    std::unique_ptr<AISolver> solver_instance;
+    std::shared_ptr<SolveJob> solve_job; // the running AI search, polled by run()
     bool aiFoundNoSolution = false;
 
 public:
@@ -684,7 +434,7 @@ private:
     void drawWinScreen();
     void drawLoseScreen();
     void drawRules();
-    void updateAIProgress(int current_val, int max_val);
+    void pollAISolving();
     bool processMouseEvents();
     void handleMouseDown(POINT pt);
     void handleMouseUp(POINT pt);
@@ -704,9 +454,7 @@ HiQGame::HiQGame() : currentState(MENU), currentBoard(nullptr), selectedPos(-1,
     lastFrameTime = chrono::high_resolution_clock::now();
 }
 HiQGame::~HiQGame() {
-    if (isSolving && solver_instance) {
-        solver_instance->stop();
-    }
+    if (solve_job) solve_job->cancel();
     UICache::cleanup();
     EndBatchDraw();
     closegraph();
@@ -726,6 +474,8 @@ void HiQGame::initializeLevels() {
     level2.name = "十字困境"; level2.type = SQUARE; level2.description = "十字棋盘的经典残局";
     level2.initialState = { {-1,-1,0,1,0,-1,-1}, {-1,-1,1,1,1,-1,-1}, {0,1,1,0,1,1,0}, {1,1,0,1,0,1,1}, {0,1,1,0,1,1,0}, {-1,-1,1,1,1,-1,-1}, {-1,-1,0,1,0,-1,-1} };
     levels.push_back(level2);
+    // 十字残局的残局库由 pegtable 生成（见README），有就加载：AI提示直接查表；三角棋盘的残局库首次求解时自动生成
+    TablebaseLibrary::shared().load("level2.pegtable", SquareBoard().getGeometry());
 }
 void HiQGame::setupButtons() {
     buttons.clear();
@@ -754,7 +504,7 @@ void HiQGame::setupButtons() {
         buttons.push_back(make_unique<Button>(520, 380, 80, 30, L"撤销", RGB(255, 215, 0)));
         buttons.push_back(make_unique<Button>(620, 380, 80, 30, L"重置", RGB(255, 165, 0)));
         if (isSolving) {
-            if (solver_instance && solver_instance->isPaused()) {
+            if (solve_job && solve_job->isPaused()) {
                 buttons.push_back(make_unique<Button>(520, 420, 80, 30, L"继续", RGB(0, 220, 0)));
             }
             else {
@@ -783,6 +533,7 @@ void HiQGame::run() {
         auto deltaTime = chrono::duration<float>(currentTime - lastFrameTime).count();
         lastFrameTime = currentTime;
         bool eventsProcessed = processMouseEvents();
+        pollAISolving();
         if (eventsProcessed || needsRedraw || isAnimatingMove || !particles.empty()) {
             updateAnimations(deltaTime);
             cleardevice();
@@ -858,7 +609,7 @@ void HiQGame::drawLevelSelection() {
 }
 void HiQGame::drawGame() {
     if (!currentBoard) return;
-    currentBoard->drawBoard(100, 150);
+    drawBoard(*currentBoard, 100, 150);
     drawGameHighlights();
     drawGameInfo();
     for (auto& button : buttons) button->draw();
@@ -945,7 +696,7 @@ void HiQGame::drawGameInfo() {
     outtextxy(520, 240, _T("1. 点击棋子选择"));
     outtextxy(520, 260, _T("2. 点击目标位置移动"));
     if (isSolving) {
-        if (solver_instance && solver_instance->isPaused()) {
+        if (solve_job && solve_job->isPaused()) {
             settextcolor(RGB(255, 165, 0)); settextstyle(18, 0, _T("楷体")); outtextxy(520, 330, _T("⏸️ AI 思考已暂停..."));
         }
         else {
@@ -1003,10 +754,22 @@ void HiQGame::drawRules() {
     outtextxy(50, 430, _T("• 🎮 残局挑战：预设的困难关卡"));
     for (auto& button : buttons) button->draw();
 }
-void HiQGame::updateAIProgress(int current_val, int max_val) {
-    if (max_val > 0) solveProgress = (std::min)(1.0f, (float)current_val / max_val);
-    else if (current_val == 1 && max_val == 1) solveProgress = 1.0f;
-    else solveProgress = 0.0f;
+// Takes the AI job's progress and, once it has ended, its result; only this thread touches the game
+void HiQGame::pollAISolving() {
+    if (!solve_job) return;
+    float progress = solve_job->getProgress();
+    if (progress != solveProgress) {
+        solveProgress = progress;
+        needsRedraw = true;
+    }
+    if (!solve_job->isDone()) return;
+    SolveResult result = solve_job->getFuture().get();
+    solve_job.reset();
+    isSolving = false;
+    solutionSteps = result.moves;
+    showAIHints = !solutionSteps.empty();
+    aiFoundNoSolution = solutionSteps.empty() && result.stop == SearchStop::Finished;
+    setupButtons();
     needsRedraw = true;
 }
 bool HiQGame::processMouseEvents() {
@@ -1064,10 +827,10 @@ void HiQGame::handleMouseUp(POINT pt) {
 }
 
 void HiQGame::interruptAI() {
-    if (isSolving && solver_instance) {
+    if (isSolving && solve_job) {
         cout << "User interrupted AI search." << endl;
-        solver_instance->stop();
-        solver_instance.reset();
+        solve_job->cancel();
+        solve_job.reset();
     }
     isSolving = false;
     showAIHints = false;
@@ -1107,9 +870,9 @@ void HiQGame::handleButtonClick(int buttonIndex) {
     case GAME_PLAYING:
         if (buttonIndex == 2) {
             if (isSolving) {
-                if (solver_instance) {
-                    if (solver_instance->isPaused()) solver_instance->resume();
-                    else solver_instance->pause();
+                if (solve_job) {
+                    if (solve_job->isPaused()) solve_job->resume();
+                    else solve_job->pause();
                 }
                 setupButtons();
             }
@@ -1151,26 +914,10 @@ void HiQGame::startAISolving() {
     isSolving = true;
     solveProgress = 0.0f;
     aiFoundNoSolution = false;
-    setupButtons();
-    if (currentBoard) {
-        solver_instance = std::make_shared<AISolver>(currentBoard.get(), 1);
-        thread([this]() {
-            auto progress_callback = [this](int cur, int max) { this->updateAIProgress(cur, max); };
-            solutionSteps = solver_instance->findSolution(progress_callback);
-            bool timed_out = solver_instance->hasTimedOut();
-            isSolving = false;
-            if (solutionSteps.empty() && !timed_out) {
-                showAIHints = false;
-                aiFoundNoSolution = true;
-            }
-            else {
-                showAIHints = !solutionSteps.empty();
-                aiFoundNoSolution = false;
-            }
-            solver_instance.reset();
-            setupButtons();
-            needsRedraw = true;
-            }).detach();
+    if (currentBoard && solver_instance) {
+        // The solver searches a copy of the board on its own thread; pollAISolving collects the result
+        solve_job = solver_instance->solveAsync(*currentBoard);
+        setupButtons();
     }
     else {
         isSolving = false;
@@ -1252,6 +999,9 @@ void HiQGame::startNewGame(BoardType type) {
     case SQUARE: currentBoard = std::make_unique<SquareBoard>(); break;
     case HEXAGON: currentBoard = std::make_unique<HexagonBoard>(); break;
     }
+    // A solver per board; the old one cancels its jobs and waits for them to end
+    solve_job.reset();
+    solver_instance = currentBoard ? std::make_unique<AISolver>(currentBoard.get(), 1) : nullptr;
     selectedPos = { -1, -1 };
     highlightedMoves.clear();
     showAIHints = false;
@@ -1269,6 +1019,9 @@ void HiQGame::startLevel(int levelIndex) {
     case SQUARE: currentBoard = std::make_unique<SquareBoard>(); break;
     case HEXAGON: currentBoard = std::make_unique<HexagonBoard>(); break;
     }
+    // A solver per board; the old one cancels its jobs and waits for them to end
+    solve_job.reset();
+    solver_instance = currentBoard ? std::make_unique<AISolver>(currentBoard.get(), 1) : nullptr;
     if (currentBoard) {
         currentBoard->resetBoard();
         for (size_t r = 0; r < level.initialState.size(); r++) {
@@ -1283,7 +1036,6 @@ void HiQGame::startLevel(int levelIndex) {
             }
         }
         currentBoard->clearBoardHistory();
-        currentBoard->addToBoardHistory(currentBoard->getGrid());
     }
     selectedPos = { -1, -1 };
     highlightedMoves.clear();
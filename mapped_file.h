@@ -0,0 +1,14 @@
+// mapped_file.h
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Maps a whole file read-only; nullptr if it is missing, empty or cannot be mapped.
+// `handle` receives what unmapFile needs besides the address (a mapping handle on Windows).
+const std::uint8_t* mapFile(const std::string& path, std::size_t& size, void*& handle);
+void unmapFile(const std::uint8_t* data, std::size_t size, void* handle);
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,114 @@
+#include "move_batch_lanes.h"
+#include <algorithm>
+#include <map>
+#include <tuple>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+MoveBatch::MoveBatch(const BoardGeometry& g) : geometry(g), cellJumps(g.getCellCount()), kernel(bestKernel()), count(0) {
+    // Jumps of one direction whose middle and landing holes sit at the same index offsets
+    map<tuple<int, int, int, int>, int> groupOf;
+    for (int move = 0; move < geometry.getJumpCount(); ++move) {
+        const Jump& jump = geometry.getJump((MoveIndex)move);
+        Position from = geometry.getCellPosition(jump.from), to = geometry.getCellPosition(jump.to);
+        auto key = make_tuple(to.x - from.x, to.y - from.y, jump.over - jump.from, jump.to - jump.from);
+        auto found = groupOf.find(key);
+        if (found == groupOf.end()) {
+            found = groupOf.emplace(key, (int)plan.groups.size()).first;
+            plan.groups.push_back({ 0, jump.over - jump.from, jump.to - jump.from });
+        }
+        plan.groups[found->second].sources |= cellBit(jump.from);
+        cellJumps[jump.from].push_back({ found->second, (MoveIndex)move });
+    }
+
+    // The island neighbourhood of AISolver::buildIslandTables, one step per index offset
+    const int dx[] = { -1, 1, 0, 0, -1, -1, 1, 1, -2, 2, 0, 0, -2, -2, 2, 2 };
+    const int dy[] = { 0, 0, -1, 1, -1, 1, -1, 1,  0, 0, -2, 2, -2, 2, -2, 2 };
+    map<int, BitMask> stepCells;
+    for (int cell = 0; cell < geometry.getCellCount(); ++cell) {
+        Position p = geometry.getCellPosition(cell);
+        for (int i = 0; i < 16; ++i) {
+            int neighbour = geometry.getCellIndex(p.x + dx[i], p.y + dy[i]);
+            if (neighbour >= 0) stepCells[neighbour - cell] |= cellBit(cell);
+        }
+    }
+    for (const auto& step : stepCells) plan.neighbours.push_back({ step.second, step.first });
+
+    lanes.groupSources.assign(plan.groups.size() * MAX_LANES, 0);
+}
+
+static bool cpuHasAvx2() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    // The OS has to save the YMM registers too
+    if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#else
+    return false;
+#endif
+}
+
+bool MoveBatch::isSupported(Kernel k) {
+    switch (k) {
+    case Kernel::Avx2: {
+        static const bool supported = moveBatchAvx2Kernel() && cpuHasAvx2();
+        return supported;
+    }
+#if defined(MOVE_BATCH_SSE2)
+    case Kernel::Sse2: return true;
+#endif
+    case Kernel::Scalar: return true;
+    default: return false;
+    }
+}
+
+MoveBatch::Kernel MoveBatch::bestKernel() {
+    if (isSupported(Kernel::Avx2)) return Kernel::Avx2;
+    if (isSupported(Kernel::Sse2)) return Kernel::Sse2;
+    return Kernel::Scalar;
+}
+
+const char* MoveBatch::kernelName(Kernel k) {
+    switch (k) {
+    case Kernel::Avx2: return "avx2";
+    case Kernel::Sse2: return "sse2";
+    default: return "scalar";
+    }
+}
+
+void MoveBatch::setKernel(Kernel k) {
+    if (isSupported(k)) kernel = k;
+}
+
+void MoveBatch::evaluate(const BitMask* pegs, int n, bool heuristic) {
+    count = (std::min)((std::max)(n, 0), (int)MAX_LANES);
+    // Lanes past the last position hold an empty board, so kernels always run whole vectors
+    for (int lane = 0; lane < MAX_LANES; ++lane) lanes.pegs[lane] = lane < count ? pegs[lane] : 0;
+    switch (kernel) {
+    case Kernel::Avx2: moveBatchAvx2Kernel()(plan, lanes, count, heuristic); break;
+#if defined(MOVE_BATCH_SSE2)
+    case Kernel::Sse2: evaluateLanes<Sse2Lanes>(plan, lanes, count, heuristic); break;
+#endif
+    default: evaluateLanes<ScalarLanes>(plan, lanes, count, heuristic); break;
+    }
+}
+
+void MoveBatch::getMoves(int lane, MoveList& moves) const {
+    moves.size = 0;
+    for (BitMask movable = lanes.movable[lane]; movable; movable &= movable - 1) {
+        int cell = lowestBit(movable);
+        for (const CellJump& jump : cellJumps[cell]) {
+            if (lanes.groupSources[jump.group * MAX_LANES + lane] & cellBit(cell)) moves.moves[moves.size++] = jump.move;
+        }
+    }
+}
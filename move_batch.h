@@ -0,0 +1,84 @@
+// move_batch.h
+#ifndef MOVE_BATCH_H
+#define MOVE_BATCH_H
+
+#include <cstdint>
+#include <vector>
+#include "bitboard.h"
+
+// Jump table of a geometry as shift-and-mask steps. Jumps are grouped by direction and by the
+// cell index offsets of their middle and landing holes; every source of a group is tested at once:
+//     sources = pegs & (pegs >> over) & ~(pegs >> to) & group.sources
+// (negative offsets shift left). The island neighbourhood of AISolver's heuristic is grouped
+// the same way, so flood fills also run as shifts.
+struct MoveBatchPlan {
+    struct JumpGroup {
+        BitMask sources; // cells that have a jump of this group
+        int over, to;    // cell index offsets of the middle and landing holes
+    };
+    struct Step {
+        BitMask cells;   // cells that have a neighbour at this offset
+        int offset;
+    };
+    std::vector<JumpGroup> groups;
+    std::vector<Step> neighbours;
+};
+
+// Results of one MoveBatch::evaluate, one 64-bit word per lane so kernels store whole vectors.
+// Group sources are group-major: groupSources[group * MAX_LANES + lane].
+struct MoveBatchLanes {
+    static const int MAX_LANES = 16;
+    BitMask pegs[MAX_LANES];
+    BitMask movable[MAX_LANES];
+    std::uint64_t pegCounts[MAX_LANES], moveCounts[MAX_LANES], islands[MAX_LANES];
+    std::vector<BitMask> groupSources;
+};
+
+// Move generation and evaluation of up to 16 positions of one geometry at once, in SIMD lanes:
+// four per AVX2 register, two per SSE2 register, or one at a time. The kernel is picked at run
+// time from what the CPU supports, so one binary runs on every x86-64 machine.
+// Not thread safe; give each thread its own batch.
+class MoveBatch {
+public:
+    static const int MAX_LANES = MoveBatchLanes::MAX_LANES;
+    enum class Kernel { Scalar, Sse2, Avx2 };
+
+    explicit MoveBatch(const BoardGeometry& geometry);
+
+    const BoardGeometry& getGeometry() const { return geometry; }
+    // The widest kernel this CPU and build support
+    static Kernel bestKernel();
+    static bool isSupported(Kernel kernel);
+    static const char* kernelName(Kernel kernel);
+    Kernel getKernel() const { return kernel; }
+    // For comparisons; an unsupported kernel leaves the current one in place
+    void setKernel(Kernel k);
+
+    // Evaluates `count` positions, at most MAX_LANES; lane i is pegs[i]. Without `heuristic`
+    // the islands are not counted and getHeuristic is 0.
+    void evaluate(const BitMask* pegs, int count, bool heuristic = true);
+    int size() const { return count; }
+    int getPegCount(int lane) const { return (int)lanes.pegCounts[lane]; }
+    int getMoveCount(int lane) const { return (int)lanes.moveCounts[lane]; }
+    // Pegs that have at least one jump
+    BitMask getMovable(int lane) const { return lanes.movable[lane]; }
+    // Islands - 1, the lower bound AISolver searches with
+    int getHeuristic(int lane) const { return lanes.islands[lane] > 0 ? (int)lanes.islands[lane] - 1 : 0; }
+    // The lane's moves, in the order of BitBoard::getAllPossibleMoves
+    void getMoves(int lane, MoveList& moves) const;
+
+private:
+    struct CellJump {
+        int group;
+        MoveIndex move;
+    };
+
+    const BoardGeometry& geometry;
+    MoveBatchPlan plan;
+    std::vector<std::vector<CellJump>> cellJumps; // [cell], in jump table order
+    Kernel kernel;
+    int count;
+    MoveBatchLanes lanes;
+};
+
+#endif // MOVE_BATCH_H
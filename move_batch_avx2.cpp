@@ -0,0 +1,12 @@
+// Built with AVX2 enabled (see CMakeLists.txt); MoveBatch only calls in after checking the CPU
+#include "move_batch_lanes.h"
+
+#if defined(__AVX2__)
+static void evaluateAvx2(const MoveBatchPlan& plan, MoveBatchLanes& lanes, int count, bool heuristic) {
+    evaluateLanes<Avx2Lanes>(plan, lanes, count, heuristic);
+}
+
+MoveBatchKernelFunction moveBatchAvx2Kernel() { return evaluateAvx2; }
+#else
+MoveBatchKernelFunction moveBatchAvx2Kernel() { return nullptr; }
+#endif
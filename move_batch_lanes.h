@@ -0,0 +1,147 @@
+// move_batch_lanes.h: the kernels of MoveBatch, shared by move_batch.cpp and move_batch_avx2.cpp.
+// Each file instantiates the lane types its compiler flags allow. The templates have internal
+// linkage, so the linker never swaps a copy built for AVX2 into code that has to run without it.
+#ifndef MOVE_BATCH_LANES_H
+#define MOVE_BATCH_LANES_H
+
+#include "move_batch.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MOVE_BATCH_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+typedef void (*MoveBatchKernelFunction)(const MoveBatchPlan& plan, MoveBatchLanes& lanes, int count, bool heuristic);
+// Defined in move_batch_avx2.cpp; nullptr when that file was built without AVX2
+MoveBatchKernelFunction moveBatchAvx2Kernel();
+
+namespace {
+
+struct ScalarLanes {
+    typedef std::uint64_t V;
+    static const int WIDTH = 1;
+    static V load(const std::uint64_t* p) { return *p; }
+    static void store(std::uint64_t* p, V v) { *p = v; }
+    static V set1(std::uint64_t x) { return x; }
+    static V andBits(V a, V b) { return a & b; }
+    static V andNot(V a, V b) { return ~a & b; }
+    static V orBits(V a, V b) { return a | b; }
+    static V xorBits(V a, V b) { return a ^ b; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    // Positive offsets shift towards bit 0
+    static V shift(V v, int offset) { return offset >= 0 ? v >> offset : v << -offset; }
+    static V count(V v) { return (V)popCount(v); }
+    static V nonZero(V v) { return v != 0; }
+    static bool any(V v) { return v != 0; }
+};
+
+#if defined(MOVE_BATCH_SSE2)
+struct Sse2Lanes {
+    typedef __m128i V;
+    static const int WIDTH = 2;
+    static V load(const std::uint64_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static void store(std::uint64_t* p, V v) { _mm_storeu_si128((__m128i*)p, v); }
+    static V set1(std::uint64_t x) { return _mm_set1_epi64x((long long)x); }
+    static V andBits(V a, V b) { return _mm_and_si128(a, b); }
+    static V andNot(V a, V b) { return _mm_andnot_si128(a, b); }
+    static V orBits(V a, V b) { return _mm_or_si128(a, b); }
+    static V xorBits(V a, V b) { return _mm_xor_si128(a, b); }
+    static V add(V a, V b) { return _mm_add_epi64(a, b); }
+    static V sub(V a, V b) { return _mm_sub_epi64(a, b); }
+    static V shift(V v, int offset) {
+        return offset >= 0 ? _mm_srl_epi64(v, _mm_cvtsi32_si128(offset)) : _mm_sll_epi64(v, _mm_cvtsi32_si128(-offset));
+    }
+    // Bit counts per byte, then summed per lane by SAD against zero
+    static V count(V v) {
+        v = _mm_sub_epi64(v, _mm_and_si128(_mm_srli_epi64(v, 1), set1(0x5555555555555555ULL)));
+        v = _mm_add_epi64(_mm_and_si128(v, set1(0x3333333333333333ULL)), _mm_and_si128(_mm_srli_epi64(v, 2), set1(0x3333333333333333ULL)));
+        v = _mm_and_si128(_mm_add_epi64(v, _mm_srli_epi64(v, 4)), set1(0x0F0F0F0F0F0F0F0FULL));
+        return _mm_sad_epu8(v, _mm_setzero_si128());
+    }
+    // SSE2 has no 64-bit compare: a lane is zero when both of its 32-bit halves are
+    static V nonZero(V v) {
+        V zero = _mm_cmpeq_epi32(v, _mm_setzero_si128());
+        zero = _mm_and_si128(zero, _mm_shuffle_epi32(zero, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_andnot_si128(zero, set1(1));
+    }
+    static bool any(V v) { return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF; }
+};
+#endif
+
+#if defined(__AVX2__)
+struct Avx2Lanes {
+    typedef __m256i V;
+    static const int WIDTH = 4;
+    static V load(const std::uint64_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    static void store(std::uint64_t* p, V v) { _mm256_storeu_si256((__m256i*)p, v); }
+    static V set1(std::uint64_t x) { return _mm256_set1_epi64x((long long)x); }
+    static V andBits(V a, V b) { return _mm256_and_si256(a, b); }
+    static V andNot(V a, V b) { return _mm256_andnot_si256(a, b); }
+    static V orBits(V a, V b) { return _mm256_or_si256(a, b); }
+    static V xorBits(V a, V b) { return _mm256_xor_si256(a, b); }
+    static V add(V a, V b) { return _mm256_add_epi64(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_epi64(a, b); }
+    static V shift(V v, int offset) {
+        return offset >= 0 ? _mm256_srl_epi64(v, _mm_cvtsi32_si128(offset)) : _mm256_sll_epi64(v, _mm_cvtsi32_si128(-offset));
+    }
+    // Nibble lookup per byte, then summed per lane by SAD against zero
+    static V count(V v) {
+        const V table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const V low = _mm256_set1_epi8(0x0F);
+        V counts = _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(v, low)),
+            _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi64(v, 4), low)));
+        return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+    }
+    static V nonZero(V v) { return _mm256_andnot_si256(_mm256_cmpeq_epi64(v, _mm256_setzero_si256()), set1(1)); }
+    static bool any(V v) { return !_mm256_testz_si256(v, v); }
+};
+#endif
+
+template <class L>
+void evaluateLanes(const MoveBatchPlan& plan, MoveBatchLanes& out, int count, bool heuristic) {
+    typedef typename L::V V;
+    const V zero = L::set1(0);
+    for (int base = 0; base < count; base += L::WIDTH) {
+        V pegs = L::load(out.pegs + base);
+        V movable = zero, moves = zero;
+        for (size_t g = 0; g < plan.groups.size(); ++g) {
+            const MoveBatchPlan::JumpGroup& group = plan.groups[g];
+            V sources = L::andBits(L::andBits(pegs, L::shift(pegs, group.over)), L::andNot(L::shift(pegs, group.to), L::set1(group.sources)));
+            L::store(out.groupSources.data() + g * MoveBatchLanes::MAX_LANES + base, sources);
+            movable = L::orBits(movable, sources);
+            moves = L::add(moves, L::count(sources));
+        }
+        L::store(out.movable + base, movable);
+        L::store(out.moveCounts + base, moves);
+        L::store(out.pegCounts + base, L::count(pegs));
+        if (!heuristic) {
+            L::store(out.islands + base, zero);
+            continue;
+        }
+
+        // Islands: every lane grows the island of its lowest remaining peg until no lane changes
+        V remaining = pegs, islands = zero;
+        while (L::any(remaining)) {
+            V island = L::andBits(remaining, L::sub(zero, remaining));
+            while (true) {
+                V grown = island;
+                for (const MoveBatchPlan::Step& step : plan.neighbours) {
+                    grown = L::orBits(grown, L::shift(L::andBits(island, L::set1(step.cells)), -step.offset));
+                }
+                grown = L::andBits(grown, remaining);
+                if (!L::any(L::xorBits(grown, island))) break;
+                island = grown;
+            }
+            remaining = L::andNot(island, remaining);
+            islands = L::add(islands, L::nonZero(island));
+        }
+        L::store(out.islands + base, islands);
+    }
+}
+
+} // namespace
+
+#endif // MOVE_BATCH_LANES_H
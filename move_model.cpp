@@ -0,0 +1,183 @@
+#include "move_model.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MOVE_MODEL_SSE2 1
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+static const char FILE_MAGIC[8] = { 'P', 'E', 'G', 'M', 'O', 'D', 'E', 'L' };
+static const uint32_t FILE_VERSION = 1;
+
+#pragma pack(push, 1)
+struct ModelHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t cells;
+    uint32_t hidden1;
+    uint32_t hidden2;
+    uint64_t geometry;      // BoardGeometry::getFingerprint
+    uint32_t target;
+    uint32_t reserved;
+    uint64_t weightCount;
+    uint64_t weightChecksum;
+    uint64_t checksum;      // of the fields above
+};
+#pragma pack(pop)
+static_assert(sizeof(ModelHeader) == 64, "ModelHeader is part of the file format");
+
+// FNV-1a, as in the solution store
+static uint64_t checksum(const void* data, size_t bytes) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < bytes; ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static int roundHidden(int size) {
+    return (std::max)(4, (std::min)((size + 3) & ~3, (int)MoveModel::MAX_HIDDEN));
+}
+
+static size_t weightCount(int cells, int hidden1, int hidden2) {
+    return (size_t)cells * hidden1 + hidden1 + (size_t)hidden2 * hidden1 + hidden2 + hidden2 + 1;
+}
+
+// Vector kernels over `n` floats, n a multiple of four
+
+static void addRow(float* sums, const float* row, int n) {
+#if defined(MOVE_MODEL_SSE2)
+    for (int i = 0; i < n; i += 4) _mm_storeu_ps(sums + i, _mm_add_ps(_mm_loadu_ps(sums + i), _mm_loadu_ps(row + i)));
+#else
+    for (int i = 0; i < n; ++i) sums[i] += row[i];
+#endif
+}
+
+// sums += plus - minus1 - minus2, the first layer of a child
+static void moveRows(float* sums, const float* plus, const float* minus1, const float* minus2, int n) {
+#if defined(MOVE_MODEL_SSE2)
+    for (int i = 0; i < n; i += 4) {
+        __m128 row = _mm_sub_ps(_mm_loadu_ps(plus + i), _mm_add_ps(_mm_loadu_ps(minus1 + i), _mm_loadu_ps(minus2 + i)));
+        _mm_storeu_ps(sums + i, _mm_add_ps(_mm_loadu_ps(sums + i), row));
+    }
+#else
+    for (int i = 0; i < n; ++i) sums[i] += plus[i] - minus1[i] - minus2[i];
+#endif
+}
+
+static void relu(const float* in, float* out, int n) {
+#if defined(MOVE_MODEL_SSE2)
+    for (int i = 0; i < n; i += 4) _mm_storeu_ps(out + i, _mm_max_ps(_mm_loadu_ps(in + i), _mm_setzero_ps()));
+#else
+    for (int i = 0; i < n; ++i) out[i] = (std::max)(in[i], 0.0f);
+#endif
+}
+
+static float dot(const float* a, const float* b, int n) {
+#if defined(MOVE_MODEL_SSE2)
+    __m128 sum = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 4) sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+#else
+    float sum = 0;
+    for (int i = 0; i < n; ++i) sum += a[i] * b[i];
+    return sum;
+#endif
+}
+
+MoveModel::MoveModel(const BoardGeometry& g, int h1, int h2, int t, unsigned seed)
+    : geometry(g), cells(g.getCellCount()), hidden1(roundHidden(h1)), hidden2(roundHidden(h2)), target(t),
+    weights(weightCount(cells, hidden1, hidden2), 0.0f) {
+    // Uniform within +-sqrt(6 / fan-in), biases zero
+    mt19937 rng(seed);
+    auto fill = [&](size_t offset, size_t count, int fanIn) {
+        uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+        float scale = sqrt(6.0f / (float)fanIn);
+        for (size_t i = 0; i < count; ++i) weights[offset + i] = scale * uniform(rng);
+    };
+    fill(0, firstBiasOffset(), (std::max)(1, cells / 2));
+    fill(secondLayerOffset(), (size_t)hidden2 * hidden1, hidden1);
+    fill(outputOffset(), hidden2, hidden2);
+}
+
+unique_ptr<MoveModel> MoveModel::load(const string& path, const BoardGeometry& geometry) {
+    ifstream in(path, ios::binary);
+    ModelHeader header;
+    if (!in.read((char*)&header, sizeof(header)) || memcmp(header.magic, FILE_MAGIC, 8) != 0 ||
+        header.version != FILE_VERSION || header.checksum != checksum(&header, offsetof(ModelHeader, checksum)) ||
+        header.geometry != geometry.getFingerprint() || header.cells != (uint32_t)geometry.getCellCount() ||
+        header.hidden1 != (uint32_t)roundHidden((int)header.hidden1) || header.hidden2 != (uint32_t)roundHidden((int)header.hidden2) ||
+        header.weightCount != weightCount((int)header.cells, (int)header.hidden1, (int)header.hidden2)) return nullptr;
+    unique_ptr<MoveModel> model(new MoveModel(geometry, (int)header.hidden1, (int)header.hidden2, (int)header.target, 0));
+    vector<float>& weights = model->weights;
+    if (!in.read((char*)weights.data(), (streamsize)(weights.size() * sizeof(float))) ||
+        header.weightChecksum != checksum(weights.data(), weights.size() * sizeof(float))) return nullptr;
+    return model;
+}
+
+bool MoveModel::save(const string& path) const {
+    ModelHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FILE_MAGIC, 8);
+    header.version = FILE_VERSION;
+    header.cells = (uint32_t)cells;
+    header.hidden1 = (uint32_t)hidden1;
+    header.hidden2 = (uint32_t)hidden2;
+    header.geometry = geometry.getFingerprint();
+    header.target = (uint32_t)target;
+    header.weightCount = weights.size();
+    header.weightChecksum = checksum(weights.data(), weights.size() * sizeof(float));
+    header.checksum = checksum(&header, offsetof(ModelHeader, checksum));
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)weights.data(), (streamsize)(weights.size() * sizeof(float)));
+    return (bool)out.flush();
+}
+
+float MoveModel::finish(const float* sums) const {
+    alignas(16) float first[MAX_HIDDEN], second[MAX_HIDDEN];
+    relu(sums, first, hidden1);
+    const float* layer = weights.data() + secondLayerOffset();
+    const float* biases = weights.data() + secondBiasOffset();
+    for (int j = 0; j < hidden2; ++j) second[j] = biases[j] + dot(layer + (size_t)j * hidden1, first, hidden1);
+    relu(second, second, hidden2);
+    const float* output = weights.data() + outputOffset();
+    return output[hidden2] + dot(output, second, hidden2);
+}
+
+float MoveModel::evaluate(BitMask pegs) const {
+    float score;
+    evaluate(&pegs, 1, &score);
+    return score;
+}
+
+void MoveModel::evaluate(const BitMask* pegs, int count, float* scores) const {
+    alignas(16) float sums[MAX_HIDDEN];
+    for (int i = 0; i < count; ++i) {
+        memcpy(sums, weights.data() + firstBiasOffset(), hidden1 * sizeof(float));
+        for (BitMask rest = pegs[i]; rest; rest &= rest - 1) addRow(sums, weights.data() + (size_t)lowestBit(rest) * hidden1, hidden1);
+        scores[i] = finish(sums);
+    }
+}
+
+void MoveModel::scoreMoves(BitMask pegs, const MoveList& moves, float* scores) const {
+    alignas(16) float parent[MAX_HIDDEN], child[MAX_HIDDEN];
+    memcpy(parent, weights.data() + firstBiasOffset(), hidden1 * sizeof(float));
+    for (BitMask rest = pegs; rest; rest &= rest - 1) addRow(parent, weights.data() + (size_t)lowestBit(rest) * hidden1, hidden1);
+    const float* rows = weights.data();
+    for (int i = 0; i < moves.size; ++i) {
+        const Jump& jump = geometry.getJump(moves.moves[i]);
+        memcpy(child, parent, hidden1 * sizeof(float));
+        moveRows(child, rows + (size_t)jump.to * hidden1, rows + (size_t)jump.from * hidden1, rows + (size_t)jump.over * hidden1, hidden1);
+        scores[i] = finish(child);
+    }
+}
@@ -0,0 +1,62 @@
+// move_model.h
+#ifndef MOVE_MODEL_H
+#define MOVE_MODEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bitboard.h"
+
+// A small network that rates how likely a position is to be solvable, for move ordering:
+// one input per hole (1 = peg), two ReLU layers and one output, the logit of "can be played
+// down to getTarget() pegs". pegtrain fits it to the solvable layers PositionLayers writes.
+//
+// The first layer is a sum of one weight row per peg, so a child's sums are its parent's with
+// three rows changed (scoreMoves). Hidden sizes are multiples of four; the kernels run on SSE2
+// where the compiler has it and fall back to scalar code otherwise.
+//
+// File: a 64-byte header (magic, version, sizes, geometry fingerprint, checksums), then the
+// weights as little-endian floats in getWeights() order. Immutable once loaded, so one model
+// serves every search thread.
+class MoveModel {
+public:
+    static const int MAX_HIDDEN = 64;
+
+    // Small random weights from `seed`, for a trainer to start from
+    MoveModel(const BoardGeometry& geometry, int hidden1, int hidden2, int target, unsigned seed);
+    // nullptr if the file is missing, damaged, of another version or of another geometry
+    static std::unique_ptr<MoveModel> load(const std::string& path, const BoardGeometry& geometry);
+    bool save(const std::string& path) const;
+
+    const BoardGeometry& getGeometry() const { return geometry; }
+    int getTarget() const { return target; }
+    int getHidden1() const { return hidden1; }
+    int getHidden2() const { return hidden2; }
+
+    float evaluate(BitMask pegs) const;
+    // scores[i] for pegs[i]
+    void evaluate(const BitMask* pegs, int count, float* scores) const;
+    // scores[i] for the child reached by moves.moves[i]
+    void scoreMoves(BitMask pegs, const MoveList& moves, float* scores) const;
+
+    // For trainers, in file order: first layer [cell][hidden1] and its biases, second layer
+    // [hidden2][hidden1] and its biases, output weights [hidden2] and bias
+    std::vector<float>& getWeights() { return weights; }
+    const std::vector<float>& getWeights() const { return weights; }
+    std::size_t firstBiasOffset() const { return (std::size_t)cells * hidden1; }
+    std::size_t secondLayerOffset() const { return firstBiasOffset() + hidden1; }
+    std::size_t secondBiasOffset() const { return secondLayerOffset() + (std::size_t)hidden2 * hidden1; }
+    std::size_t outputOffset() const { return secondBiasOffset() + hidden2; }
+
+private:
+    const BoardGeometry& geometry;
+    int cells, hidden1, hidden2, target;
+    std::vector<float> weights;
+
+    // The output for first-layer sums `sums`, before the ReLU
+    float finish(const float* sums) const;
+};
+
+#endif // MOVE_MODEL_H
@@ -0,0 +1,105 @@
+#include "move_ordering.h"
+#include <algorithm>
+
+using namespace std;
+
+// Sort key layout, high bits first: killer rank, learned score, history score, static score.
+// Without the learned score history takes its bits too.
+static const int HISTORY_SHIFT = 16;
+static const int LEARNED_SHIFT = 46;
+static const int KILLER_SHIFT = 62;
+static const uint64_t HISTORY_LIMIT = (uint64_t(1) << (KILLER_SHIFT - HISTORY_SHIFT)) - 1;
+static const uint64_t LEARNED_HISTORY_LIMIT = (uint64_t(1) << (LEARNED_SHIFT - HISTORY_SHIFT)) - 1;
+
+// A logit as 16 bits that sort the same way; 1/1024 steps between -32 and 32
+static uint64_t learnedKey(float logit) {
+    float key = (logit + 32.0f) * 1024.0f;
+    return key <= 0.0f ? 0 : key >= 65535.0f ? 65535 : (uint64_t)key;
+}
+
+MoveOrderer::MoveOrderer(const BoardGeometry& geometry, const MoveOrdering& o, const MoveModel* m)
+    : ordering(o), model(m), jumpCount(geometry.getJumpCount()),
+    staticScores(new uint16_t[geometry.getJumpCount()]),
+    historyScores(new atomic<uint64_t>[geometry.getJumpCount()]) {
+    ordering.killers = (std::max)(0, (std::min)(ordering.killers, (int)MoveOrdering::MAX_KILLERS));
+    if (!model || model->getGeometry().getFingerprint() != geometry.getFingerprint()) {
+        model = nullptr;
+        ordering.learned = false;
+    }
+
+    // Squared distance of the jumping peg from the centre of the holes, in half-cell units
+    int cells = geometry.getCellCount(), sumX = 0, sumY = 0;
+    for (int cell = 0; cell < cells; ++cell) {
+        sumX += geometry.getCellPosition(cell).x;
+        sumY += geometry.getCellPosition(cell).y;
+    }
+    int centreX = cells ? 2 * sumX / cells : 0, centreY = cells ? 2 * sumY / cells : 0;
+    for (int move = 0; move < jumpCount; ++move) {
+        Position from = geometry.getCellPosition(geometry.getJump((MoveIndex)move).from);
+        int dx = 2 * from.x - centreX, dy = 2 * from.y - centreY;
+        staticScores[move] = (uint16_t)(std::min)(dx * dx + dy * dy, 0xFFFF);
+    }
+    clear();
+}
+
+void MoveOrderer::clear() {
+    for (int move = 0; move < jumpCount; ++move) historyScores[move].store(0, memory_order_relaxed);
+    for (auto& slots : killerMoves) {
+        for (auto& killer : slots) killer.store(NO_MOVE, memory_order_relaxed);
+    }
+}
+
+void MoveOrderer::age() {
+    for (int move = 0; move < jumpCount; ++move) {
+        historyScores[move].store(historyScores[move].load(memory_order_relaxed) / 2, memory_order_relaxed);
+    }
+}
+
+void MoveOrderer::order(MoveList& moves, int ply, BitMask pegs) const {
+    if (!ordering.enabled() || moves.size < 2) return;
+    uint64_t keys[MAX_JUMPS];
+    float scores[MAX_JUMPS];
+    if (ordering.learned) model->scoreMoves(pegs, moves, scores);
+    uint64_t historyLimit = ordering.learned ? LEARNED_HISTORY_LIMIT : HISTORY_LIMIT;
+    for (int i = 0; i < moves.size; ++i) {
+        MoveIndex move = moves.moves[i];
+        uint64_t key = 0;
+        if (ordering.staticScore) key = staticScores[move];
+        if (ordering.history) key |= (std::min)(historyScores[move].load(memory_order_relaxed), historyLimit) << HISTORY_SHIFT;
+        if (ordering.learned) key |= learnedKey(scores[i]) << LEARNED_SHIFT;
+        if (ply < MAX_PLY) {
+            for (int slot = 0; slot < ordering.killers; ++slot) {
+                if (killerMoves[ply][slot].load(memory_order_relaxed) == move) {
+                    key |= uint64_t(MoveOrdering::MAX_KILLERS - slot) << KILLER_SHIFT;
+                    break;
+                }
+            }
+        }
+        keys[i] = key;
+    }
+    // Insertion sort: lists are short, and equal keys keep the generation order
+    for (int i = 1; i < moves.size; ++i) {
+        uint64_t key = keys[i];
+        MoveIndex move = moves.moves[i];
+        int j = i;
+        for (; j > 0 && keys[j - 1] < key; --j) {
+            keys[j] = keys[j - 1];
+            moves.moves[j] = moves.moves[j - 1];
+        }
+        keys[j] = key;
+        moves.moves[j] = move;
+    }
+}
+
+void MoveOrderer::reward(MoveIndex move, int ply, int remaining) {
+    if (ordering.history) {
+        atomic<uint64_t>& score = historyScores[move];
+        score.store(score.load(memory_order_relaxed) + (uint64_t)remaining * remaining, memory_order_relaxed);
+    }
+    if (ordering.killers > 0 && ply < MAX_PLY) {
+        atomic<int>* slots = killerMoves[ply];
+        if (slots[0].load(memory_order_relaxed) == move) return;
+        for (int slot = ordering.killers - 1; slot > 0; --slot) slots[slot].store(slots[slot - 1].load(memory_order_relaxed), memory_order_relaxed);
+        slots[0].store(move, memory_order_relaxed);
+    }
+}
@@ -0,0 +1,59 @@
+// move_ordering.h
+#ifndef MOVE_ORDERING_H
+#define MOVE_ORDERING_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "bitboard.h"
+#include "move_model.h"
+
+// Which strategies order the children of a node. A node tries its killer moves first, then
+// the rest by learned score, history score and static score; with every strategy off the
+// children keep the order of BitBoard::getAllPossibleMoves. Board::getMoveOrdering gives each
+// board type's tuning.
+struct MoveOrdering {
+    static const int MAX_KILLERS = 2;
+
+    bool staticScore = false; // pegs far from the centre of the board jump first
+    bool history = false;     // jumps whose child was the most promising one, counted per (from, to)
+    int killers = 0;          // killer moves kept per ply, 0..MAX_KILLERS
+    bool learned = false;     // children a MoveModel rates most likely solvable; needs the solver's model
+
+    static MoveOrdering none() { return MoveOrdering(); }
+    static MoveOrdering all() { return MoveOrdering{ true, true, MAX_KILLERS }; }
+    bool enabled() const { return staticScore || history || killers > 0 || learned; }
+};
+
+// Scores of one search, shared by its threads. Updates are relaxed loads and stores, so two
+// threads crediting the same move at once may lose one credit; the ordering only gets a
+// little worse and no locked instruction sits on the hot path.
+class MoveOrderer {
+public:
+    // Without a model of the geometry MoveOrdering::learned is off
+    MoveOrderer(const BoardGeometry& geometry, const MoveOrdering& ordering, const MoveModel* model = nullptr);
+    MoveOrderer(const MoveOrderer&) = delete;
+    MoveOrderer& operator=(const MoveOrderer&) = delete;
+
+    const MoveOrdering& getOrdering() const { return ordering; }
+    // Sorts the moves of `pegs`, a node `ply` plies below the root, best first
+    void order(MoveList& moves, int ply, BitMask pegs) const;
+    // `move` led to the most promising child of a node at `ply` with `remaining` moves still to make
+    void reward(MoveIndex move, int ply, int remaining);
+    // Called between iterations: halves the history, so recent iterations weigh most
+    void age();
+    void clear();
+
+private:
+    static const int MAX_PLY = 64;
+    static const int NO_MOVE = -1;
+
+    MoveOrdering ordering;
+    const MoveModel* model;
+    int jumpCount;
+    std::unique_ptr<std::uint16_t[]> staticScores;                 // [move]
+    std::unique_ptr<std::atomic<std::uint64_t>[]> historyScores;   // [move]; a jump is one (from, to) pair
+    std::atomic<int> killerMoves[MAX_PLY][MoveOrdering::MAX_KILLERS];
+};
+
+#endif // MOVE_ORDERING_H
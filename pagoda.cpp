@@ -0,0 +1,131 @@
+#include "pagoda.h"
+#include "symmetry.h"
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+PagodaLibrary& PagodaLibrary::shared() {
+    static PagodaLibrary library;
+    static bool loaded = [] {
+        istringstream in(BUILTIN_PAGODA_TABLES);
+        return library.parse(in);
+    }();
+    (void)loaded;
+    return library;
+}
+
+bool PagodaLibrary::load(const string& path) {
+    ifstream in(path);
+    return in && parse(in);
+}
+
+bool PagodaLibrary::parse(istream& in) {
+    string line;
+    bool ok = true;
+    while (getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        istringstream fields(line);
+        Entry entry;
+        if (!(fields >> hex >> entry.geometry)) continue;
+        if (!(fields >> dec >> entry.finish)) { ok = false; continue; }
+        int weight;
+        while (fields >> weight) entry.weights.push_back(weight);
+        if (!fields.eof() || entry.weights.empty()) { ok = false; continue; }
+        add(entry);
+    }
+    return ok;
+}
+
+void PagodaLibrary::add(const Entry& entry) {
+    lock_guard<mutex> lock(entriesMutex);
+    for (const Entry& existing : entries) {
+        if (existing.geometry == entry.geometry && existing.finish == entry.finish && existing.weights == entry.weights) return;
+    }
+    entries.push_back(entry);
+}
+
+vector<PagodaLibrary::Entry> PagodaLibrary::find(uint64_t geometry, int finish) const {
+    lock_guard<mutex> lock(entriesMutex);
+    vector<Entry> found;
+    for (const Entry& entry : entries) {
+        if (entry.geometry == geometry && entry.finish == finish) found.push_back(entry);
+    }
+    return found;
+}
+
+void PagodaLibrary::write(ostream& out, const Entry& entry) {
+    out << hex << setw(16) << setfill('0') << entry.geometry << dec << setfill(' ') << ' ' << entry.finish;
+    for (int weight : entry.weights) out << ' ' << weight;
+    out << '\n';
+}
+
+bool PagodaPruner::isPagoda(const BoardGeometry& geometry, const vector<int>& weights) {
+    if ((int)weights.size() != geometry.getCellCount()) return false;
+    for (int move = 0; move < geometry.getJumpCount(); ++move) {
+        const Jump& jump = geometry.getJump((MoveIndex)move);
+        if (weights[jump.from] + weights[jump.over] < weights[jump.to]) return false;
+    }
+    return true;
+}
+
+int PagodaPruner::finishValue(const vector<int>& weights, int target, int finish) {
+    // The finishing position with the smallest sum: the finish hole (if fixed) plus the lightest other holes
+    vector<int> others;
+    for (int cell = 0; cell < (int)weights.size(); ++cell) {
+        if (cell != finish) others.push_back(weights[cell]);
+    }
+    sort(others.begin(), others.end());
+    int base = finish >= 0 ? weights[finish] : 0;
+    int extra = finish >= 0 ? target - 1 : target;
+    int best = finish >= 0 ? base : INT_MAX;
+    int sum = base;
+    for (int i = 0; i < extra && i < (int)others.size(); ++i) {
+        sum += others[i];
+        best = (min)(best, sum);
+    }
+    return best;
+}
+
+int PagodaPruner::evaluate(const vector<int>& weights, BitMask pegs) {
+    int sum = 0;
+    while (pegs) {
+        sum += weights[lowestBit(pegs)];
+        pegs &= pegs - 1;
+    }
+    return sum;
+}
+
+PagodaPruner::PagodaPruner(const BoardGeometry& geometry, const vector<vector<int>>& pagodas,
+    int target, int finish, bool symmetric) {
+    int cells = geometry.getCellCount();
+    byteCount = (cells + 7) / 8;
+    const SymmetryGroup& symmetries = geometry.getSymmetries();
+    vector<vector<int>> accepted;
+    for (const auto& weights : pagodas) {
+        if (!isPagoda(geometry, weights)) continue;
+        for (int t = 0; t < (symmetric ? symmetries.size() : 1); ++t) {
+            if (finish >= 0 && symmetries.cellImage(t, finish) != finish) continue;
+            vector<int> image(cells);
+            for (int cell = 0; cell < cells; ++cell) image[symmetries.cellImage(t, cell)] = weights[cell];
+            if (find(accepted.begin(), accepted.end(), image) == accepted.end()) accepted.push_back(image);
+        }
+    }
+    for (const auto& weights : accepted) {
+        thresholds.push_back(finishValue(weights, target, finish));
+        for (int byte = 0; byte < byteCount; ++byte) {
+            for (int value = 0; value < 256; ++value) {
+                int sum = 0;
+                for (int bit = 0; bit < 8; ++bit) {
+                    int cell = byte * 8 + bit;
+                    if ((value >> bit) & 1 && cell < cells) sum += weights[cell];
+                }
+                tables.push_back((int16_t)sum);
+            }
+        }
+    }
+}
@@ -0,0 +1,80 @@
+// pagoda.h
+#ifndef PAGODA_H
+#define PAGODA_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "bitboard.h"
+
+// A pagoda function weights the holes so that no jump raises the weighted sum of the
+// pegs: weight(from) + weight(over) >= weight(to) for every jump. A position whose sum
+// is below the smallest sum any finishing position can have cannot reach one.
+
+// Built-in tables (pagoda_tables.cpp), in the PagodaLibrary text format
+extern const char* const BUILTIN_PAGODA_TABLES;
+
+// Pagoda tables for every geometry, as written by the pagodasearch tool.
+// Text format, one pagoda per line:
+//     <geometry fingerprint, hex> <finish cell, -1 = any> <weight of cell 0> <weight of cell 1> ...
+// '#' starts a comment.
+class PagodaLibrary {
+public:
+    struct Entry {
+        std::uint64_t geometry = 0;
+        int finish = -1;
+        std::vector<int> weights;
+    };
+
+    // Built-in tables, plus whatever load() added
+    static PagodaLibrary& shared();
+
+    // Adds the tables of a file; false if it cannot be read or has a malformed line
+    bool load(const std::string& path);
+    bool parse(std::istream& in);
+    void add(const Entry& entry);
+    std::vector<Entry> find(std::uint64_t geometry, int finish) const;
+
+    static void write(std::ostream& out, const Entry& entry);
+
+private:
+    mutable std::mutex entriesMutex;
+    std::vector<Entry> entries;
+};
+
+// Pagodas of one geometry compiled into byte lookup tables: a pagoda sum costs one
+// load per byte of the peg mask, independent of the number of pegs.
+class PagodaPruner {
+public:
+    // `target` is the most pegs a finishing position may have; `finish` its last hole or -1.
+    // Weights that are not a pagoda of the geometry are dropped; with `symmetric` every
+    // image of a pagoda under the geometry's symmetries is added as well.
+    PagodaPruner(const BoardGeometry& geometry, const std::vector<std::vector<int>>& pagodas,
+        int target, int finish = -1, bool symmetric = true);
+
+    static bool isPagoda(const BoardGeometry& geometry, const std::vector<int>& weights);
+    // Smallest weighted sum of a finishing position
+    static int finishValue(const std::vector<int>& weights, int target, int finish);
+    static int evaluate(const std::vector<int>& weights, BitMask pegs);
+
+    int size() const { return (int)thresholds.size(); }
+    // True if some pagoda proves that `pegs` cannot reach a finishing position
+    bool prunes(BitMask pegs) const {
+        for (int p = 0; p < size(); ++p) {
+            const std::int16_t* table = tables.data() + (std::size_t)p * byteCount * 256;
+            int sum = 0;
+            for (int byte = 0; byte < byteCount; ++byte) sum += table[byte * 256 + ((pegs >> (8 * byte)) & 0xFF)];
+            if (sum < thresholds[p]) return true;
+        }
+        return false;
+    }
+
+private:
+    int byteCount;
+    std::vector<std::int16_t> tables;  // [pagoda][byte][value] -> weight of those pegs
+    std::vector<int> thresholds;       // [pagoda] -> finishValue
+};
+
+#endif // PAGODA_H
@@ -0,0 +1,21 @@
+// Built-in pagoda tables, in the PagodaLibrary text format.
+// Generated by pagodasearch with the command above each group; finish -1 = any hole.
+#include "pagoda.h"
+
+const char* const BUILTIN_PAGODA_TABLES = R"(
+# pagodasearch --board triangle
+# prunes 158 more samples
+32e7f4aae5af24fa -1 -1 1 3 0 3 0 1 3 0 3 -1 3 0 3 -1
+# prunes 80 more samples
+32e7f4aae5af24fa -1 -3 3 3 0 2 0 3 2 1 3 -3 3 0 3 -3
+# pagodasearch --board square
+# prunes 1227 more samples
+41e99c67551fde70 -1 0 0 0 1 1 1 2 1 1 1 1 2 -1 0 2 2 1 2 1 1 2 1 1 2 1 3 -2 3 2 3 -2 0 -2
+# prunes 2549 more samples
+41e99c67551fde70 -1 -2 2 -2 3 0 3 -2 2 0 2 0 2 0 3 0 3 0 3 2 2 -2 2 0 2 2 0 2 3 1 3 -2 1 -1
+# prunes 548 more samples
+41e99c67551fde70 -1 -2 2 -2 3 1 3 -1 2 1 3 0 3 -2 2 0 2 1 3 3 0 -1 2 1 2 1 3 -2 3 1 2 -2 1 -1
+# pagodasearch --board hexagon
+# prunes 13418 more samples
+fc85527f3136ff27 -1 -2 -2 3 -2 -2 3 1 2 -1 -2 3 1 2 0 2 -2 -2 2 0 2 0 2 0 2 -2 -2 3 1 2 1 2 -1 -1 1 0 1 -1 0 2 0 -2
+)";
@@ -0,0 +1,198 @@
+// pagodasearch: offline search for pagoda functions that prune a board's search
+//
+// Samples reachable positions by random play from the board's opening and from every
+// single-vacancy start, then looks for integer pagodas (weights in [-range, range])
+// that prove as many of the samples hopeless as possible. Each pagoda is found by
+// randomized hill climbing over the integer weights, keeping the jump inequalities
+// satisfied at every step; pagodas are picked greedily, each one scored only on the
+// samples the earlier ones do not already prune.
+//
+// The result is written in the PagodaLibrary text format; paste it into
+// pagoda_tables.cpp to make it built in, or hand it to PagodaLibrary::load.
+#include "board.h"
+#include "pagoda.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+struct Options {
+    string board = "square";
+    int finishX = -1, finishY = -1;
+    int target = 1;
+    int count = 3;
+    int range = 3;
+    int samples = 20000;
+    int iterations = 20000;
+    int restarts = 4;
+    unsigned seed = 1;
+};
+
+// Positions reached by random play, with more pegs than the target
+static vector<BitMask> samplePositions(const Board& board, const Options& options, mt19937& rng) {
+    const BoardGeometry& geometry = board.getGeometry();
+    vector<BitMask> starts = { board.toBitBoard().getPegs() };
+    for (int cell = 0; cell < geometry.getCellCount(); ++cell) starts.push_back(geometry.getValidMask() & ~cellBit(cell));
+    unordered_set<BitMask> seen;
+    vector<BitMask> positions;
+    for (int attempt = 0; (int)positions.size() < options.samples && attempt < options.samples * 4; ++attempt) {
+        BitBoard position(geometry, starts[rng() % starts.size()]);
+        int moves = (int)(rng() % position.getPegCount());
+        for (int i = 0; i < moves; ++i) {
+            MoveList legal;
+            position.getAllPossibleMoves(legal);
+            if (legal.empty()) break;
+            position.makeMove(legal.moves[rng() % legal.size]);
+        }
+        if (position.getPegCount() > options.target && seen.insert(position.getPegs()).second) {
+            positions.push_back(position.getPegs());
+        }
+    }
+    return positions;
+}
+
+struct Search {
+    const BoardGeometry& geometry;
+    const Options& options;
+    int finish;
+    const vector<BitMask>& positions;
+    const vector<bool>& covered;
+    vector<vector<int>> jumpsOfCell;
+
+    Search(const BoardGeometry& g, const Options& o, int f, const vector<BitMask>& p, const vector<bool>& c)
+        : geometry(g), options(o), finish(f), positions(p), covered(c), jumpsOfCell(g.getCellCount()) {
+        for (int move = 0; move < g.getJumpCount(); ++move) {
+            const Jump& jump = g.getJump((MoveIndex)move);
+            jumpsOfCell[jump.from].push_back(move);
+            jumpsOfCell[jump.over].push_back(move);
+            jumpsOfCell[jump.to].push_back(move);
+        }
+    }
+
+    bool locallyValid(const vector<int>& weights, int cell) const {
+        for (int move : jumpsOfCell[cell]) {
+            const Jump& jump = geometry.getJump((MoveIndex)move);
+            if (weights[jump.from] + weights[jump.over] < weights[jump.to]) return false;
+        }
+        return true;
+    }
+
+    int score(const vector<int>& sums, int threshold) const {
+        int pruned = 0;
+        for (size_t i = 0; i < positions.size(); ++i) pruned += !covered[i] && sums[i] < threshold;
+        return pruned;
+    }
+
+    // Hill climbing from a constant pagoda (every constant c >= 0 is one); sideways moves
+    // are accepted to cross plateaus
+    vector<int> climb(mt19937& rng, int& bestScore) const {
+        int cells = geometry.getCellCount();
+        int start = (int)(rng() % (options.range + 1));
+        vector<int> weights(cells, start), best = weights;
+        vector<int> sums(positions.size());
+        for (size_t i = 0; i < positions.size(); ++i) sums[i] = start * popCount(positions[i]);
+        int current = score(sums, PagodaPruner::finishValue(weights, options.target, finish));
+        bestScore = current;
+        for (int iteration = 0; iteration < options.iterations; ++iteration) {
+            int cell = (int)(rng() % cells);
+            int delta = rng() % 2 ? 1 : -1;
+            if (abs(weights[cell] + delta) > options.range) continue;
+            weights[cell] += delta;
+            if (!locallyValid(weights, cell)) { weights[cell] -= delta; continue; }
+            for (size_t i = 0; i < positions.size(); ++i) {
+                if (positions[i] & cellBit(cell)) sums[i] += delta;
+            }
+            int candidate = score(sums, PagodaPruner::finishValue(weights, options.target, finish));
+            if (candidate >= current) {
+                current = candidate;
+                if (current > bestScore) { bestScore = current; best = weights; }
+            }
+            else {
+                weights[cell] -= delta;
+                for (size_t i = 0; i < positions.size(); ++i) {
+                    if (positions[i] & cellBit(cell)) sums[i] -= delta;
+                }
+            }
+        }
+        return best;
+    }
+};
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--board" && hasValue) options.board = argv[++i];
+        else if (arg == "--finish" && hasValue) {
+            string value = argv[++i];
+            size_t comma = value.find(',');
+            if (comma == string::npos) { cerr << "pagodasearch: --finish takes x,y" << endl; return 2; }
+            options.finishX = atoi(value.substr(0, comma).c_str());
+            options.finishY = atoi(value.substr(comma + 1).c_str());
+        }
+        else if (arg == "--target" && hasValue) options.target = (max)(1, atoi(argv[++i]));
+        else if (arg == "--count" && hasValue) options.count = (max)(1, atoi(argv[++i]));
+        else if (arg == "--range" && hasValue) options.range = (max)(1, atoi(argv[++i]));
+        else if (arg == "--samples" && hasValue) options.samples = (max)(1, atoi(argv[++i]));
+        else if (arg == "--iterations" && hasValue) options.iterations = (max)(1, atoi(argv[++i]));
+        else if (arg == "--restarts" && hasValue) options.restarts = (max)(1, atoi(argv[++i]));
+        else if (arg == "--seed" && hasValue) options.seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else {
+            cerr << "usage: pagodasearch [--board triangle|square|hexagon] [--finish x,y] [--target pegs]\n"
+                "                    [--count n] [--range r] [--samples n] [--iterations n] [--restarts n] [--seed n]" << endl;
+            return 2;
+        }
+    }
+    unique_ptr<Board> board = makeBoard(options.board);
+    if (!board) {
+        cerr << "pagodasearch: unknown board " << options.board << endl;
+        return 2;
+    }
+    const BoardGeometry& geometry = board->getGeometry();
+    int finish = -1;
+    if (options.finishX >= 0) {
+        finish = geometry.getCellIndex(options.finishX, options.finishY);
+        if (finish < 0) {
+            cerr << "pagodasearch: no hole at " << options.finishX << "," << options.finishY << endl;
+            return 2;
+        }
+    }
+
+    mt19937 rng(options.seed);
+    vector<BitMask> positions = samplePositions(*board, options, rng);
+    vector<bool> covered(positions.size(), false);
+    cout << "# " << options.board << ", finish " << (finish < 0 ? string("any") : to_string(options.finishX) + "," + to_string(options.finishY))
+        << ", target " << options.target << ", " << positions.size() << " sampled positions" << endl;
+
+    for (int n = 0; n < options.count; ++n) {
+        Search search(geometry, options, finish, positions, covered);
+        vector<int> best;
+        int bestScore = 0;
+        for (int restart = 0; restart < options.restarts; ++restart) {
+            int score;
+            vector<int> weights = search.climb(rng, score);
+            if (score > bestScore) { bestScore = score; best = weights; }
+        }
+        if (bestScore == 0) break;
+        // Images of a pagoda prune too (the solver adds them), so they count as covered
+        PagodaPruner pruner(geometry, { best }, options.target, finish);
+        int total = 0;
+        for (size_t i = 0; i < positions.size(); ++i) {
+            if (!covered[i] && pruner.prunes(positions[i])) { covered[i] = true; total++; }
+        }
+        cout << "# prunes " << total << " more samples" << endl;
+        PagodaLibrary::Entry entry;
+        entry.geometry = geometry.getFingerprint();
+        entry.finish = finish;
+        entry.weights = best;
+        PagodaLibrary::write(cout, entry);
+    }
+    return 0;
+}
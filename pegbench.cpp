@@ -0,0 +1,444 @@
+// pegbench: microbenchmarks of the rules and solver hot paths
+//
+// Every position set is generated from a fixed seed, so two builds measure the
+// same positions. Sets: the opening of each board, and the two endgames of
+// HiQGame::initializeLevels, each with random playouts from it.
+//
+// For every set and operation it reports ns/op, heap allocations per op and
+// operations (nodes) per second; full findSolution runs report nodes expanded
+// per second and per solve. --json writes one JSON object per line instead of a table.
+// --model adds the MoveModel of a board (see pegtrain): its inference speed, and
+// the same solves with moves ordered by it.
+#include "ai_solver.h"
+#include "board.h"
+#include "move_batch.h"
+#include "move_model.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+// Every heap allocation in the process goes through these: each form of operator new and
+// delete (array, sized, nothrow, and the aligned ones the table buckets use) calls allocate
+// and release, so none of them escapes the count
+static atomic<long long> allocation_count(0);
+
+static void* allocate(size_t size, size_t alignment) {
+    allocation_count.fetch_add(1, memory_order_relaxed);
+    size = size ? size : 1;
+    if (alignment <= alignof(max_align_t)) return malloc(size);
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    void* p = nullptr;
+    return posix_memalign(&p, alignment, size) == 0 ? p : nullptr;
+#endif
+}
+
+static void release(void* p, size_t alignment) {
+#ifdef _WIN32
+    if (alignment > alignof(max_align_t)) {
+        _aligned_free(p);
+        return;
+    }
+#else
+    (void)alignment;
+#endif
+    free(p);
+}
+
+static void* allocateOrThrow(size_t size, size_t alignment) {
+    if (void* p = allocate(size, alignment)) return p;
+    throw bad_alloc();
+}
+
+void* operator new(size_t size) { return allocateOrThrow(size, 0); }
+void* operator new[](size_t size) { return allocateOrThrow(size, 0); }
+void* operator new(size_t size, align_val_t alignment) { return allocateOrThrow(size, (size_t)alignment); }
+void* operator new[](size_t size, align_val_t alignment) { return allocateOrThrow(size, (size_t)alignment); }
+void* operator new(size_t size, const nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new[](size_t size, const nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new(size_t size, align_val_t alignment, const nothrow_t&) noexcept { return allocate(size, (size_t)alignment); }
+void* operator new[](size_t size, align_val_t alignment, const nothrow_t&) noexcept { return allocate(size, (size_t)alignment); }
+void operator delete(void* p) noexcept { release(p, 0); }
+void operator delete[](void* p) noexcept { release(p, 0); }
+void operator delete(void* p, size_t) noexcept { release(p, 0); }
+void operator delete[](void* p, size_t) noexcept { release(p, 0); }
+void operator delete(void* p, const nothrow_t&) noexcept { release(p, 0); }
+void operator delete[](void* p, const nothrow_t&) noexcept { release(p, 0); }
+void operator delete(void* p, align_val_t alignment) noexcept { release(p, (size_t)alignment); }
+void operator delete[](void* p, align_val_t alignment) noexcept { release(p, (size_t)alignment); }
+void operator delete(void* p, size_t, align_val_t alignment) noexcept { release(p, (size_t)alignment); }
+void operator delete[](void* p, size_t, align_val_t alignment) noexcept { release(p, (size_t)alignment); }
+void operator delete(void* p, align_val_t alignment, const nothrow_t&) noexcept { release(p, (size_t)alignment); }
+void operator delete[](void* p, align_val_t alignment, const nothrow_t&) noexcept { release(p, (size_t)alignment); }
+
+struct Options {
+    double minSeconds = 0.2;
+    int positions = 64;
+    unsigned seed = 20250618;
+    bool json = false;
+    bool slow = false;      // also solve the slow cross endgame
+    vector<string> modelPaths;
+};
+
+struct PositionSet {
+    string name;
+    vector<unique_ptr<Board>> boards;
+    vector<unique_ptr<Board>> solveBoards; // positions for full findSolution runs
+};
+
+struct Result {
+    string set, op;
+    double nsPerOp;
+    double allocsPerOp;
+    double nodesPerSecond;
+    double nodesPerOp = 0;  // positions expanded per solve; 0 for other operations
+};
+
+static unique_ptr<Board> levelBoard(int level) {
+    // Same layouts as HiQGame::initializeLevels
+    vector<vector<int>> state;
+    unique_ptr<Board> board;
+    if (level == 1) {
+        board = make_unique<TriangleBoard>();
+        state = { {1,-1,-1,-1,-1}, {1,1,-1,-1,-1}, {0,1,0,-1,-1}, {0,0,1,0,-1}, {0,0,0,0,0} };
+    }
+    else {
+        board = make_unique<SquareBoard>();
+        state = { {-1,-1,0,1,0,-1,-1}, {-1,-1,1,1,1,-1,-1}, {0,1,1,0,1,1,0}, {1,1,0,1,0,1,1}, {0,1,1,0,1,1,0}, {-1,-1,1,1,1,-1,-1}, {-1,-1,0,1,0,-1,-1} };
+    }
+    for (size_t r = 0; r < state.size(); r++)
+        for (size_t c = 0; c < state[r].size(); c++)
+            if (board->isValidPosition((int)c, (int)r)) board->setPeg((int)c, (int)r, state[r][c]);
+    board->clearBoardHistory();
+    return board;
+}
+
+// Plays up to `moves` random legal moves from `start`
+static unique_ptr<Board> playout(const Board& start, int moves, mt19937& rng) {
+    unique_ptr<Board> board = start.clone(false);
+    for (int i = 0; i < moves; ++i) {
+        vector<Move> legal = board->getAllPossibleMoves();
+        if (legal.empty()) break;
+        board->makeMove(legal[rng() % legal.size()]);
+    }
+    board->clearBoardHistory();
+    return board;
+}
+
+static PositionSet makeSet(const string& name, unique_ptr<Board> start, int solvePegs, const Options& options, mt19937& rng) {
+    PositionSet set;
+    set.name = name;
+    int pegs = start->getPegCount();
+    for (int i = 0; i < options.positions; ++i) set.boards.push_back(playout(*start, (int)(rng() % pegs), rng));
+    // Full solves start from playouts down to `solvePegs`, so every build searches the same trees
+    if (solvePegs > 0) {
+        for (int i = 0; i < 4; ++i) set.solveBoards.push_back(playout(*start, (std::max)(0, pegs - solvePegs), rng));
+    }
+    set.boards.push_back(move(start));
+    return set;
+}
+
+static volatile long long sink;
+
+// Runs `op` over every board of the set until minSeconds have passed
+static Result measure(const string& setName, const string& opName, const Options& options, size_t count,
+    const function<void(size_t)>& op) {
+    long long ops = 0;
+    long long allocationsBefore = allocation_count.load();
+    auto start = chrono::steady_clock::now();
+    double elapsed = 0;
+    do {
+        for (size_t i = 0; i < count; ++i) op(i);
+        ops += (long long)count;
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (elapsed < options.minSeconds);
+    long long allocations = allocation_count.load() - allocationsBefore;
+    Result result;
+    result.set = setName;
+    result.op = opName;
+    result.nsPerOp = elapsed * 1e9 / ops;
+    result.allocsPerOp = (double)allocations / ops;
+    result.nodesPerSecond = ops / elapsed;
+    return result;
+}
+
+static void benchPrimitives(const PositionSet& set, const MoveModel* model, const Options& options, vector<Result>& results) {
+    const auto& boards = set.boards;
+    size_t n = boards.size();
+    vector<BitBoard> bitBoards;
+    vector<Move> firstMoves(n);
+    vector<MoveIndex> firstIndices(n); // MAX_JUMPS - 1 when the position has no move
+    for (size_t i = 0; i < n; ++i) {
+        bitBoards.push_back(boards[i]->toBitBoard());
+        vector<Move> legal = boards[i]->getAllPossibleMoves();
+        if (!legal.empty()) firstMoves[i] = legal[0];
+        MoveList moves;
+        bitBoards[i].getAllPossibleMoves(moves);
+        firstIndices[i] = moves.empty() ? MAX_JUMPS - 1 : moves.moves[0];
+    }
+    AISolver solver(boards.back().get());
+    solver.estimateCost(bitBoards[0]); // builds the island tables outside the timed loop
+
+    results.push_back(measure(set.name, "Board::getAllPossibleMoves", options, n, [&](size_t i) {
+        sink = sink + (long long)boards[i]->getAllPossibleMoves().size();
+    }));
+    results.push_back(measure(set.name, "Board::getStateHash", options, n, [&](size_t i) {
+        sink = sink + (long long)boards[i]->getStateHash().size();
+    }));
+    results.push_back(measure(set.name, "Board::makeMove+undoMove", options, n, [&](size_t i) {
+        if (firstMoves[i].from_x < 0) return;
+        boards[i]->makeMove(firstMoves[i]);
+        boards[i]->undoMove();
+    }));
+    results.push_back(measure(set.name, "Board::clone", options, n, [&](size_t i) {
+        sink = sink + boards[i]->clone()->getWidth();
+    }));
+    results.push_back(measure(set.name, "Board::clone(no history)", options, n, [&](size_t i) {
+        sink = sink + boards[i]->clone(false)->getWidth();
+    }));
+    results.push_back(measure(set.name, "BitBoard::getAllPossibleMoves", options, n, [&](size_t i) {
+        MoveList moves;
+        bitBoards[i].getAllPossibleMoves(moves);
+        sink = sink + moves.size;
+    }));
+    results.push_back(measure(set.name, "BitBoard::makeMove+undoMove", options, n, [&](size_t i) {
+        if (firstIndices[i] == MAX_JUMPS - 1) return;
+        bitBoards[i].makeMove(firstIndices[i]);
+        bitBoards[i].undoMove(firstIndices[i]);
+    }));
+    results.push_back(measure(set.name, "AISolver::calculateHeuristic", options, n, [&](size_t i) {
+        sink = sink + solver.estimateCost(bitBoards[i]);
+    }));
+
+    // Moves, peg count and heuristic of every position, one at a time and MAX_LANES at once;
+    // batch rows are per position
+    results.push_back(measure(set.name, "moves+pegs+heuristic", options, n, [&](size_t i) {
+        MoveList moves;
+        bitBoards[i].getAllPossibleMoves(moves);
+        sink = sink + moves.size + bitBoards[i].getPegCount() + solver.estimateCost(bitBoards[i]);
+    }));
+    vector<BitMask> pegs;
+    for (size_t i = 0; i < n + MoveBatch::MAX_LANES; ++i) pegs.push_back(bitBoards[i % n].getPegs());
+    size_t batches = (n + MoveBatch::MAX_LANES - 1) / MoveBatch::MAX_LANES;
+    MoveBatch batch(bitBoards[0].getGeometry());
+    for (MoveBatch::Kernel kernel : { MoveBatch::Kernel::Scalar, MoveBatch::Kernel::Sse2, MoveBatch::Kernel::Avx2 }) {
+        if (!MoveBatch::isSupported(kernel)) continue;
+        batch.setKernel(kernel);
+        // With the heuristic it matches moves+pegs+heuristic, without it BitBoard::getAllPossibleMoves
+        for (bool heuristic : { true, false }) {
+            string op = string("MoveBatch(") + MoveBatch::kernelName(kernel) + (heuristic ? ")::evaluate" : ")::evaluate(moves)+getMoves");
+            Result result = measure(set.name, op, options, batches, [&](size_t b) {
+                batch.evaluate(pegs.data() + b * MoveBatch::MAX_LANES, MoveBatch::MAX_LANES, heuristic);
+                for (int lane = 0; lane < batch.size(); ++lane) {
+                    if (heuristic) {
+                        sink = sink + batch.getMoveCount(lane) + batch.getPegCount(lane) + batch.getHeuristic(lane);
+                        continue;
+                    }
+                    MoveList moves;
+                    batch.getMoves(lane, moves);
+                    sink = sink + moves.size;
+                }
+            });
+            result.nsPerOp /= MoveBatch::MAX_LANES;
+            result.allocsPerOp /= MoveBatch::MAX_LANES;
+            result.nodesPerSecond *= MoveBatch::MAX_LANES;
+            results.push_back(result);
+        }
+    }
+    // Inference per position: the whole set as one batch, and the children of each position
+    // from their parent's first layer
+    if (model) {
+        vector<float> scores(n);
+        Result result = measure(set.name, "MoveModel::evaluate", options, 1, [&](size_t) {
+            model->evaluate(pegs.data(), (int)n, scores.data());
+            sink = sink + (long long)scores[0];
+        });
+        result.nsPerOp /= n;
+        result.allocsPerOp /= n;
+        result.nodesPerSecond *= n;
+        results.push_back(result);
+        long long children = 0;
+        vector<MoveList> moveLists(n);
+        for (size_t i = 0; i < n; ++i) {
+            bitBoards[i].getAllPossibleMoves(moveLists[i]);
+            children += moveLists[i].size;
+        }
+        if (children > 0) {
+            result = measure(set.name, "MoveModel::scoreMoves(per child)", options, n, [&](size_t i) {
+                float childScores[MAX_JUMPS];
+                model->scoreMoves(pegs[i], moveLists[i], childScores);
+                sink = sink + moveLists[i].size;
+            });
+            double perSet = (double)children / n;
+            result.nsPerOp /= perSet;
+            result.allocsPerOp /= perSet;
+            result.nodesPerSecond *= perSet;
+            results.push_back(result);
+        }
+    }
+    if (unique_ptr<Tablebase> table = Tablebase::buildFull(bitBoards[0].getGeometry(), 1)) {
+        results.push_back(measure(set.name, "Tablebase::lookup", options, n, [&](size_t i) {
+            uint8_t entry;
+            if (table->lookup(bitBoards[i].getPegs(), entry)) sink = sink + entry;
+        }));
+    }
+}
+
+// Solves every board with a fresh solver set up by `configure`; `op` names the rows
+static void benchSolve(const PositionSet& set, const vector<Board*>& boards, SolutionStore& store, const string& op,
+    const function<void(AISolver&)>& configure, vector<Result>& results) {
+    if (boards.empty()) return;
+    long long nodes = 0, allocations = 0;
+    double seconds = 0;
+    for (Board* board : boards) {
+        // Cold tables for every run, so runs do not feed each other
+        TranspositionTable::shared().clear();
+        AISolver solver(board);
+        solver.setLogStream(nullptr);
+        solver.setSolutionStore(store);
+        if (configure) configure(solver);
+        long long allocationsBefore = allocation_count.load();
+        auto start = chrono::steady_clock::now();
+        solver.findSolution();
+        seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        allocations += allocation_count.load() - allocationsBefore;
+        nodes += solver.getNodesSearched();
+    }
+    Result result;
+    result.set = set.name;
+    result.op = op;
+    result.nsPerOp = seconds * 1e9 / boards.size();
+    result.allocsPerOp = (double)allocations / boards.size();
+    result.nodesPerSecond = seconds > 0 ? nodes / seconds : 0;
+    result.nodesPerOp = (double)nodes / boards.size();
+    results.push_back(result);
+    // The same runs per node expanded; allocations are the solver's setup spread over its nodes
+    if (nodes > 0) {
+        result.op = op + "/node";
+        result.nsPerOp = seconds * 1e9 / nodes;
+        result.allocsPerOp = (double)allocations / nodes;
+        result.nodesPerOp = 1;
+        results.push_back(result);
+    }
+}
+
+static void printResult(const Result& result, bool json) {
+    if (json) {
+        cout << "{\"set\":\"" << result.set << "\",\"op\":\"" << result.op << "\",\"ns_per_op\":" << fixed << setprecision(2)
+            << result.nsPerOp << ",\"allocs_per_op\":" << setprecision(3) << result.allocsPerOp
+            << ",\"nodes_per_sec\":" << setprecision(0) << result.nodesPerSecond
+            << ",\"nodes_per_op\":" << result.nodesPerOp << "}" << endl;
+    }
+    else {
+        cout << left << setw(10) << result.set << setw(52) << result.op << right << fixed
+            << setprecision(1) << setw(16) << result.nsPerOp << setprecision(2) << setw(12) << result.allocsPerOp
+            << setprecision(0) << setw(16) << result.nodesPerSecond << setw(14) << result.nodesPerOp << endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--json") options.json = true;
+        else if (arg == "--slow") options.slow = true;
+        else if (arg == "--min-time" && i + 1 < argc) options.minSeconds = atof(argv[++i]);
+        else if (arg == "--positions" && i + 1 < argc) options.positions = (std::max)(1, atoi(argv[++i]));
+        else if (arg == "--seed" && i + 1 < argc) options.seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--model" && i + 1 < argc) options.modelPaths.push_back(argv[++i]);
+        else {
+            cerr << "usage: pegbench [--json] [--slow] [--min-time seconds] [--positions n] [--seed n] [--model file]..." << endl;
+            return 2;
+        }
+    }
+
+    mt19937 rng(options.seed);
+    vector<PositionSet> sets;
+    sets.push_back(makeSet("triangle", make_unique<TriangleBoard>(), 10, options, rng));
+    sets.push_back(makeSet("square", make_unique<SquareBoard>(), 12, options, rng));
+    sets.push_back(makeSet("hexagon", make_unique<HexagonBoard>(), 12, options, rng));
+    sets.push_back(makeSet("level1", levelBoard(1), 0, options, rng));
+    sets.push_back(makeSet("level2", levelBoard(2), 0, options, rng));
+
+    // Private stores, emptied first, and no tablebases, so findSolution always searches
+    TablebaseLibrary::shared().setAutomaticBuild(false);
+    const char* storePath = "pegbench_solutions.bin";
+    const char* unorderedStorePath = "pegbench_unordered.bin";
+    const char* depthFirstStorePath = "pegbench_depth_first.bin";
+    const char* modelStorePath = "pegbench_model.bin";
+    const char* depthFirstModelStorePath = "pegbench_depth_first_model.bin";
+    for (const char* path : { storePath, unorderedStorePath, depthFirstStorePath, modelStorePath, depthFirstModelStorePath }) remove(path);
+    {
+        SolutionStore store(storePath), unorderedStore(unorderedStorePath), depthFirstStore(depthFirstStorePath);
+        SolutionStore modelStore(modelStorePath), depthFirstModelStore(depthFirstModelStorePath);
+
+        if (!options.json) {
+            cout << left << setw(10) << "set" << setw(52) << "op" << right << setw(16) << "ns/op"
+                << setw(12) << "allocs/op" << setw(16) << "nodes/s" << setw(14) << "nodes/op" << endl;
+        }
+        for (const PositionSet& set : sets) {
+            vector<Result> results;
+            unique_ptr<MoveModel> model;
+            for (size_t i = 0; i < options.modelPaths.size() && !model; ++i) model = MoveModel::load(options.modelPaths[i], set.boards[0]->getGeometry());
+            benchPrimitives(set, model.get(), options, results);
+            vector<Board*> solveBoards;
+            for (const auto& board : set.solveBoards) solveBoards.push_back(board.get());
+            // The level endgames are solved as given; the cross one takes minutes and needs --slow
+            if (set.name == "level1" || (set.name == "level2" && options.slow)) solveBoards.push_back(set.boards.back().get());
+            // Time to the first solution with the board's move ordering and without any, and of the depth-first mode
+            benchSolve(set, solveBoards, store, "AISolver::findSolution", nullptr, results);
+            benchSolve(set, solveBoards, unorderedStore, "AISolver::findSolution/unordered", [](AISolver& solver) {
+                solver.setMoveOrdering(MoveOrdering::none());
+            }, results);
+            benchSolve(set, solveBoards, depthFirstStore, "AISolver::findSolution/depth-first", [](AISolver& solver) {
+                DeadPositionSet::shared().clear();
+                solver.setSearchMode(SearchMode::DepthFirst);
+            }, results);
+            // Nodes to the solution with the learned score ahead of history. The depth-first
+            // pass also solves the opening, where the order decides how soon it finds a solution.
+            if (model) {
+                auto useModel = [&](AISolver& solver) {
+                    MoveOrdering ordering = set.boards[0]->getMoveOrdering();
+                    ordering.learned = true;
+                    solver.setMoveOrdering(ordering);
+                    solver.setMoveModel(model.get());
+                };
+                auto depthFirst = [](AISolver& solver) {
+                    DeadPositionSet::shared().clear();
+                    solver.setSearchMode(SearchMode::DepthFirst);
+                };
+                benchSolve(set, solveBoards, modelStore, "AISolver::findSolution/model", useModel, results);
+                benchSolve(set, solveBoards, depthFirstModelStore, "AISolver::findSolution/depth-first+model", [&](AISolver& solver) {
+                    depthFirst(solver);
+                    useModel(solver);
+                }, results);
+                vector<Board*> opening = { set.boards.back().get() };
+                benchSolve(set, opening, depthFirstStore, "AISolver::findSolution/depth-first(opening)", depthFirst, results);
+                benchSolve(set, opening, depthFirstModelStore, "AISolver::findSolution/depth-first+model(opening)", [&](AISolver& solver) {
+                    depthFirst(solver);
+                    useModel(solver);
+                }, results);
+            }
+            for (const Result& result : results) printResult(result, options.json);
+        }
+    }
+    for (const char* path : { storePath, unorderedStorePath, depthFirstStorePath, modelStorePath, depthFirstModelStorePath }) remove(path);
+    return 0;
+}
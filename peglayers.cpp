@@ -0,0 +1,93 @@
+// peglayers: enumerates every position reachable from a start into layer files on disk
+//
+//     peglayers [--dir path] [--memory mb] [-j threads] [--target pegs] <board> <cells|start>
+//     peglayers --query [--dir path] <board> <cells>
+//
+// <board> and <cells> are as in pegsolve. The first form writes one reachable and one solvable
+// file per peg count into the directory (see PositionLayers) and prints the count of every layer;
+// --memory bounds the positions held in RAM, the rest goes through sorted runs in the directory.
+// The second form looks a position up in the files and prints a solution when there is one.
+#include "board.h"
+#include "position_layers.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static int query(const Board& board, const string& directory) {
+    unique_ptr<PositionLayers> layers = PositionLayers::open(directory, board.getGeometry());
+    if (!layers) {
+        cerr << "peglayers: no layers of this board in " << directory << endl;
+        return 1;
+    }
+    BitMask pegs = board.toBitBoard().getPegs();
+    vector<MoveIndex> path;
+    if (!layers->contains(pegs)) cout << "not reachable from the start of the layers" << endl;
+    else if (!layers->solve(pegs, path)) cout << "unsolvable" << endl;
+    else {
+        cout << "solvable in " << path.size() << " moves:";
+        for (MoveIndex move : path) {
+            const Jump& jump = board.getGeometry().getJump(move);
+            cout << ' ' << (int)jump.from << '-' << (int)jump.to;
+        }
+        cout << endl;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    LayerBuildOptions options;
+    bool queryOnly = false;
+    vector<string> positional;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--dir" && i + 1 < argc) options.directory = argv[++i];
+        else if (arg == "--memory" && i + 1 < argc) options.memoryBytes = (size_t)atoll(argv[++i]) << 20;
+        else if (arg == "-j" && i + 1 < argc) options.threads = atoi(argv[++i]);
+        else if (arg == "--target" && i + 1 < argc) options.target = atoi(argv[++i]);
+        else if (arg == "--query") queryOnly = true;
+        else positional.push_back(arg);
+    }
+    unique_ptr<Board> board = positional.size() == 2 ? makeBoard(positional[0]) : nullptr;
+    if (!board || options.target < 1) {
+        cerr << "usage: peglayers [--dir path] [--memory mb] [-j threads] [--target pegs] <triangle|square|hexagon> <cells|start>" << endl
+            << "       peglayers --query [--dir path] <triangle|square|hexagon> <cells>" << endl;
+        return 2;
+    }
+    if (!setCells(*board, positional[1])) {
+        cerr << "peglayers: " << positional[1] << " does not fit the " << positional[0] << " board" << endl;
+        return 2;
+    }
+    if (queryOnly) return query(*board, options.directory);
+
+    auto start = chrono::steady_clock::now();
+    if (!PositionLayers::build(board->toBitBoard(), options, &cerr)) {
+        cerr << "peglayers: cannot write the layers to " << options.directory << endl;
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    unique_ptr<PositionLayers> layers = PositionLayers::open(options.directory, board->getGeometry());
+    if (!layers) {
+        cerr << "peglayers: " << options.directory << " does not read back" << endl;
+        return 1;
+    }
+
+    // Tab separated, one layer per line
+    uint64_t classes = 0, positions = 0, bytes = 0;
+    cout << "pegs\tclasses\tpositions\tsolvable classes\tsolvable positions\tbytes" << endl;
+    for (const PositionLayers::Layer& layer : layers->getLayers()) {
+        cout << layer.pegs << '\t' << layer.classes << '\t' << layer.positions << '\t'
+            << layer.solvableClasses << '\t' << layer.solvablePositions << '\t' << layer.bytes << endl;
+        classes += layer.classes;
+        positions += layer.positions;
+        bytes += layer.bytes;
+    }
+    cerr << "peglayers: " << classes << " classes (" << positions << " positions) in " << seconds << " s, "
+        << bytes << " bytes in " << options.directory << endl;
+    cerr << "peglayers: the start is " << (layers->isSolvable(board->toBitBoard().getPegs()) ? "solvable" : "unsolvable") << endl;
+    return 0;
+}
@@ -0,0 +1,236 @@
+// pegmatrix: which single-vacancy starts can be played down to which finishing holes
+//
+//     pegmatrix [-j jobs] [-t threads] [--bidirectional] [--time ms] [--nodes n] [--memory mb]
+//               [--tables mb] <board>
+//
+// Classifies every (start vacancy, finish hole) pair of the board: can the position with
+// every hole filled but the start be played down to one peg in the finish hole. A pair is
+// only searched when no cheaper argument answers it:
+// - a jump flips three holes, so every set of holes that each jump meets an even number of
+//   times keeps the parity of its pegs (Conway's position classes); pairs whose start and
+//   finish differ in one of those parities are unsolvable;
+// - a symmetry of the board maps a pair to one with the same answer;
+// - a game played backwards on the complement of each position turns a solution of (s, f)
+//   into one of (f, s).
+// What is left, one pair per class, is solved by -j solvers at once with the depth-first search
+// aimed at the finish hole. They share the process-wide dead-position set, so a position proven
+// unable to reach a hole is not searched again for the next start that meets it; --tables
+// sizes it as in pegsolve.
+//
+// The result is written to stdout as three tab-separated matrices, rows start vacancies and
+// columns finish holes, both labelled x,y: solvability ('+' solvable, '-' unsolvable, '?' a
+// limit stopped the search), milliseconds and nodes. A pair answered through another one shows
+// that pair's time and nodes; one ruled out by parity shows 0.
+#include "ai_solver.h"
+#include "board.h"
+#include "dead_position_set.h"
+#include "symmetry.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct Options {
+    string boardName;
+    int jobs = 0;
+    int solverThreads = 1;
+    SearchMode mode = SearchMode::DepthFirst;
+    SearchBudget budget;
+    size_t tableMegabytes = 0; // 0: the process-wide tables
+};
+
+struct PairResult {
+    char status = '?';
+    double milliseconds = 0;
+    long long nodes = 0;
+};
+
+static void printUsage() {
+    cerr << "usage: pegmatrix [-j jobs] [-t threads] [--bidirectional] [--time ms] [--nodes n] [--memory mb]\n"
+        "                 [--tables mb] <triangle|square|hexagon>\n"
+        "  -j jobs       pairs solved at once (default: one per hardware thread)\n"
+        "  -t threads    search threads per pair (default 1)\n"
+        "  --bidirectional  meet-in-the-middle search instead of the depth-first one\n"
+        "  --time ms     wall time of each search (default " << SearchBudget().milliseconds << ", 0 = none)\n"
+        "  --nodes n     positions each search may expand (default 0 = no limit)\n"
+        "  --memory mb   memory each search may use for its layers (default 0 = no limit)\n"
+        "  --tables mb   size of the dead-position set the searches share (default 32)\n";
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-j" && hasValue) options.jobs = atoi(argv[++i]);
+        else if (arg == "-t" && hasValue) options.solverThreads = atoi(argv[++i]);
+        else if (arg == "--bidirectional") options.mode = SearchMode::Bidirectional;
+        else if (arg == "--time" && hasValue) options.budget.milliseconds = atoll(argv[++i]);
+        else if (arg == "--nodes" && hasValue) options.budget.nodes = atoll(argv[++i]);
+        else if (arg == "--memory" && hasValue) options.budget.tableBytes = (size_t)atoll(argv[++i]) * 1024 * 1024;
+        else if (arg == "--tables" && hasValue) options.tableMegabytes = (size_t)atoll(argv[++i]);
+        else if (arg.size() > 1 && arg[0] == '-') return false;
+        else if (options.boardName.empty()) options.boardName = arg;
+        else return false;
+    }
+    if (options.boardName.empty()) return false;
+    if (options.jobs <= 0) options.jobs = (int)(max)(1u, thread::hardware_concurrency());
+    options.solverThreads = (max)(1, options.solverThreads);
+    return true;
+}
+
+static int parity(BitMask bits) {
+    int count = 0;
+    for (; bits; bits &= bits - 1) ++count;
+    return count & 1;
+}
+
+// Basis of the sets of holes every jump meets an even number of times: the null space over
+// GF(2) of the jump masks, read off their reduced row echelon form
+static vector<BitMask> parityInvariants(const BoardGeometry& geometry) {
+    vector<BitMask> rows;
+    vector<int> pivots;
+    for (int j = 0; j < geometry.getJumpCount(); ++j) {
+        BitMask row = geometry.getJump((MoveIndex)j).mask;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (row & cellBit(pivots[i])) row ^= rows[i];
+        }
+        if (!row) continue;
+        int pivot = 0;
+        while (!(row & cellBit(pivot))) ++pivot;
+        for (BitMask& other : rows) {
+            if (other & cellBit(pivot)) other ^= row;
+        }
+        rows.push_back(row);
+        pivots.push_back(pivot);
+    }
+    vector<BitMask> basis;
+    for (int free = 0; free < geometry.getCellCount(); ++free) {
+        if (find(pivots.begin(), pivots.end(), free) != pivots.end()) continue;
+        BitMask invariant = cellBit(free);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (rows[i] & cellBit(free)) invariant |= cellBit(pivots[i]);
+        }
+        basis.push_back(invariant);
+    }
+    return basis;
+}
+
+static void writeMatrix(ostream& out, const string& title, const BoardGeometry& geometry,
+    const vector<PairResult>& results, const function<void(ostream&, const PairResult&)>& writeCell) {
+    int cells = geometry.getCellCount();
+    out << "# " << title << endl << "start\\finish";
+    for (int finish = 0; finish < cells; ++finish) {
+        Position p = geometry.getCellPosition(finish);
+        out << '\t' << p.x << ',' << p.y;
+    }
+    out << endl;
+    for (int start = 0; start < cells; ++start) {
+        Position p = geometry.getCellPosition(start);
+        out << p.x << ',' << p.y;
+        for (int finish = 0; finish < cells; ++finish) {
+            out << '\t';
+            writeCell(out, results[start * cells + finish]);
+        }
+        out << endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    unique_ptr<Board> base = parseOptions(argc, argv, options) ? makeBoard(options.boardName) : nullptr;
+    if (!base) {
+        printUsage();
+        return 2;
+    }
+    const BoardGeometry& geometry = base->getGeometry();
+    const SymmetryGroup& symmetries = geometry.getSymmetries();
+    int cells = geometry.getCellCount();
+    BitMask full = geometry.getValidMask();
+    auto batchStart = chrono::steady_clock::now();
+    unique_ptr<DeadPositionSet> deadPositions;
+    if (options.tableMegabytes > 0) deadPositions = make_unique<DeadPositionSet>(options.tableMegabytes);
+
+    // Every pair points at the representative of its class: the smallest pair it maps to
+    vector<PairResult> results(cells * cells);
+    vector<int> representative(cells * cells, -1);
+    vector<int> searched;
+    vector<BitMask> invariants = parityInvariants(geometry);
+    int excluded = 0;
+    for (int pair = 0; pair < cells * cells; ++pair) {
+        if (representative[pair] >= 0) continue;
+        int start = pair / cells, finish = pair % cells;
+        vector<int> images;
+        for (int t = 0; t < symmetries.size(); ++t) {
+            int s = symmetries.cellImage(t, start), f = symmetries.cellImage(t, finish);
+            images.push_back(s * cells + f);
+            images.push_back(f * cells + s);
+        }
+        for (int image : images) representative[image] = pair;
+        bool reachable = true;
+        for (BitMask invariant : invariants) {
+            if (parity(full & ~cellBit(start) & invariant) != parity(cellBit(finish) & invariant)) reachable = false;
+        }
+        if (reachable) searched.push_back(pair);
+        else {
+            results[pair].status = '-';
+            ++excluded;
+        }
+    }
+    cerr << "pegmatrix: " << cells * cells << " pairs, " << excluded << " classes ruled out by parity, "
+        << searched.size() << " to search" << endl;
+
+    atomic<size_t> next(0);
+    mutex logMutex;
+    auto worker = [&]() {
+        for (size_t index; (index = next++) < searched.size();) {
+            int pair = searched[index];
+            Position start = geometry.getCellPosition(pair / cells), finish = geometry.getCellPosition(pair % cells);
+            unique_ptr<Board> board = base->clone(false);
+            for (int cell = 0; cell < cells; ++cell) {
+                Position p = geometry.getCellPosition(cell);
+                board->setPeg(p.x, p.y, cell == pair / cells ? 0 : 1);
+            }
+            auto searchStart = chrono::steady_clock::now();
+            AISolver solver(board.get(), 1);
+            solver.setLogStream(nullptr);
+            solver.setThreadCount(options.solverThreads);
+            solver.setSearchMode(options.mode);
+            if (deadPositions) solver.setDeadPositionSet(*deadPositions);
+            solver.setFinishHole(finish.x, finish.y);
+            bool solved = !solver.findSolution(options.budget).empty();
+            PairResult& result = results[pair];
+            result.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - searchStart).count();
+            result.nodes = solver.getNodesSearched();
+            result.status = solved ? '+' : solver.getStopReason() == SearchStop::Finished ? '-' : '?';
+
+            lock_guard<mutex> lock(logMutex);
+            cerr << "pegmatrix: " << start.x << ',' << start.y << " -> " << finish.x << ',' << finish.y << ' '
+                << (solved ? "solvable" : result.status == '-' ? "unsolvable" : "stopped") << " in "
+                << result.milliseconds << " ms, " << result.nodes << " nodes" << endl;
+        }
+    };
+    vector<thread> threads;
+    for (int i = 0; i < (std::min)(options.jobs, (int)searched.size()); ++i) threads.emplace_back(worker);
+    for (auto& t : threads) t.join();
+
+    for (int pair = 0; pair < cells * cells; ++pair) results[pair] = results[representative[pair]];
+    writeMatrix(cout, "solvable", geometry, results, [](ostream& out, const PairResult& r) { out << r.status; });
+    writeMatrix(cout, "milliseconds", geometry, results, [](ostream& out, const PairResult& r) { out << round(r.milliseconds * 10) / 10; });
+    writeMatrix(cout, "nodes", geometry, results, [](ostream& out, const PairResult& r) { out << r.nodes; });
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - batchStart).count();
+    int solvable = 0;
+    for (const PairResult& result : results) solvable += result.status == '+';
+    cerr << "pegmatrix: " << solvable << " of " << cells * cells << " pairs solvable, " << seconds << " s" << endl;
+    return 0;
+}
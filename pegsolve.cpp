@@ -0,0 +1,241 @@
+// pegsolve: headless batch solver
+//
+// Reads one position per line from a file or stdin:
+//     <board> <cells> [target]
+// <board> is triangle, square or hexagon. <cells> has one character per hole in
+// row-major order, '1' or 'x' for a peg and '0' or '.' for an empty hole; "start"
+// stands for the board's opening position. [target] is the number of pegs to leave
+// (default 1). Blank lines and lines starting with '#' are skipped.
+//
+// Positions are solved in parallel and each result is written as soon as it is
+// known, tab separated:
+//     <line> <board> <status> <moves> <ms> <solution>
+// with status solved, unsolvable, invalid or the limit that ended the search (timeout,
+// node-limit, memory-limit), and the solution as
+// space-separated "fx,fy>tx,ty" jumps. --stats writes each search's statistics report to stderr.
+// --bidirectional searches from both ends (SearchMode::Bidirectional) instead of by IDA*,
+// --depth-first in one pass at the solution depth (SearchMode::DepthFirst).
+// --time, --nodes and --memory set the SearchBudget of every search. --tables sizes the
+// transposition table (IDA*) or dead-position set (--depth-first) all searches share; it never grows past it.
+// --model loads a MoveModel (see pegtrain) and orders the children of every search of its
+// board by it; give it once per board.
+#include "ai_solver.h"
+#include "board.h"
+#include "dead_position_set.h"
+#include "move_model.h"
+#include "transposition_table.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct Options {
+    string input = "-";
+    int jobs = 0;
+    int solverThreads = 1;
+    string storePath = SolutionStore::DEFAULT_PATH;
+    bool compactOnly = false;
+    bool statistics = false;
+    SearchMode mode = SearchMode::IterativeDeepening;
+    SearchBudget budget;
+    size_t tableMegabytes = 0; // 0: the process-wide tables
+    vector<string> modelPaths;
+};
+
+static void printUsage() {
+    cerr << "usage: pegsolve [-j jobs] [-t threads] [--store path] [--stats] [--bidirectional | --depth-first]\n"
+        "                [--time ms] [--nodes n] [--memory mb] [--tables mb] [--model file] [--compact] [file]\n"
+        "  file          positions, one per line (default '-' = stdin)\n"
+        "  -j jobs       positions solved at once (default: one per hardware thread)\n"
+        "  -t threads    search threads per position (default 1)\n"
+        "  --store path  solution store file (default " << SolutionStore::DEFAULT_PATH << ")\n"
+        "  --stats       write search statistics of every position to stderr\n"
+        "  --bidirectional  meet-in-the-middle search instead of IDA*\n"
+        "  --depth-first    depth-first solvability search instead of IDA*\n"
+        "  --time ms     wall time of each search (default " << SearchBudget().milliseconds << ", 0 = none)\n"
+        "  --nodes n     positions each search may expand (default 0 = no limit)\n"
+        "  --memory mb   memory each bidirectional search may use for its layers (default 0 = no limit)\n"
+        "  --tables mb   size of the transposition table and of the dead-position set (default 32)\n"
+        "  --model file  order moves by a trained MoveModel, once per board\n"
+        "  --compact     compact the solution store and exit\n";
+}
+
+static string stopStatus(SearchStop reason) {
+    switch (reason) {
+    case SearchStop::TimeLimit: return "timeout";
+    case SearchStop::NodeLimit: return "node-limit";
+    case SearchStop::MemoryLimit: return "memory-limit";
+    case SearchStop::Stopped: return "stopped";
+    default: return "unsolvable";
+    }
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-j" && hasValue) options.jobs = atoi(argv[++i]);
+        else if (arg == "-t" && hasValue) options.solverThreads = atoi(argv[++i]);
+        else if (arg == "--store" && hasValue) options.storePath = argv[++i];
+        else if (arg == "--compact") options.compactOnly = true;
+        else if (arg == "--stats") options.statistics = true;
+        else if (arg == "--bidirectional") options.mode = SearchMode::Bidirectional;
+        else if (arg == "--depth-first") options.mode = SearchMode::DepthFirst;
+        else if (arg == "--time" && hasValue) options.budget.milliseconds = atoll(argv[++i]);
+        else if (arg == "--nodes" && hasValue) options.budget.nodes = atoll(argv[++i]);
+        else if (arg == "--memory" && hasValue) options.budget.tableBytes = (size_t)atoll(argv[++i]) * 1024 * 1024;
+        else if (arg == "--tables" && hasValue) options.tableMegabytes = (size_t)atoll(argv[++i]);
+        else if (arg == "--model" && hasValue) options.modelPaths.push_back(argv[++i]);
+        else if (arg == "-h" || arg == "--help") return false;
+        else if (arg.size() > 1 && arg[0] == '-') return false;
+        else options.input = arg;
+    }
+    if (options.jobs <= 0) options.jobs = (int)(max)(1u, thread::hardware_concurrency());
+    options.solverThreads = (max)(1, options.solverThreads);
+    return true;
+}
+
+static string formatSolution(const vector<Move>& moves) {
+    ostringstream out;
+    for (size_t i = 0; i < moves.size(); ++i) {
+        if (i) out << ' ';
+        out << moves[i].from_x << ',' << moves[i].from_y << '>' << moves[i].to_x << ',' << moves[i].to_y;
+    }
+    return out.str();
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+    if (options.compactOnly) {
+        long long kept = SolutionStore::compact(options.storePath);
+        if (kept < 0) {
+            cerr << "pegsolve: " << options.storePath << " is not a solution store or cannot be written" << endl;
+            return 1;
+        }
+        cerr << "pegsolve: " << kept << " solutions kept in " << options.storePath << endl;
+        return 0;
+    }
+
+    ifstream file;
+    if (options.input != "-") {
+        file.open(options.input);
+        if (!file) {
+            cerr << "pegsolve: cannot open " << options.input << endl;
+            return 1;
+        }
+    }
+    istream& input = options.input == "-" ? cin : file;
+    SolutionStore store(options.storePath);
+    if (!store.isOpen()) {
+        cerr << "pegsolve: " << options.storePath << " is not a solution store or cannot be written" << endl;
+        return 1;
+    }
+    unique_ptr<TranspositionTable> table;
+    unique_ptr<DeadPositionSet> deadPositions;
+    // Only the table of the chosen search is allocated: IDA* probes the transposition table, the
+    // depth-first search the dead-position set, and the bidirectional search neither
+    if (options.tableMegabytes > 0 && options.mode == SearchMode::IterativeDeepening) table = make_unique<TranspositionTable>(options.tableMegabytes);
+    if (options.tableMegabytes > 0 && options.mode == SearchMode::DepthFirst) deadPositions = make_unique<DeadPositionSet>(options.tableMegabytes);
+    // Each file is a model of whichever board's geometry it loads for
+    vector<unique_ptr<MoveModel>> models;
+    for (const string& path : options.modelPaths) {
+        size_t loaded = models.size();
+        for (const char* name : { "triangle", "square", "hexagon" }) {
+            if (unique_ptr<MoveModel> model = MoveModel::load(path, makeBoard(name)->getGeometry())) models.push_back(move(model));
+        }
+        if (models.size() == loaded) {
+            cerr << "pegsolve: " << path << " is not a model of any board" << endl;
+            return 1;
+        }
+    }
+
+    mutex inputMutex, outputMutex;
+    int lineNumber = 0;
+    atomic<int> solved(0), failed(0);
+    auto batchStart = chrono::steady_clock::now();
+
+    cout << "# line\tboard\tstatus\tmoves\tms\tsolution" << endl;
+    auto worker = [&]() {
+        while (true) {
+            string line;
+            int number;
+            {
+                lock_guard<mutex> lock(inputMutex);
+                if (!getline(input, line)) return;
+                number = ++lineNumber;
+            }
+            istringstream fields(line);
+            string boardName, cells;
+            int target = 1;
+            if (!(fields >> boardName) || boardName[0] == '#') continue;
+            fields >> cells;
+            if (!(fields >> target)) target = 1;
+
+            auto start = chrono::steady_clock::now();
+            unique_ptr<Board> board = makeBoard(boardName);
+            string status;
+            vector<Move> solution;
+            SearchStatistics statistics;
+            if (!board || cells.empty() || !setCells(*board, cells) || target < 1) {
+                status = "invalid";
+            }
+            else if (board->getPegCount() <= target) {
+                status = "solved";
+            }
+            else {
+                AISolver solver(board.get(), target);
+                solver.setLogStream(nullptr);
+                solver.setThreadCount(options.solverThreads);
+                solver.setSolutionStore(store);
+                solver.setStatisticsEnabled(options.statistics);
+                solver.setSearchMode(options.mode);
+                if (table) solver.setTranspositionTable(*table);
+                if (deadPositions) solver.setDeadPositionSet(*deadPositions);
+                for (const auto& model : models) {
+                    if (model->getGeometry().getFingerprint() != board->getGeometry().getFingerprint()) continue;
+                    MoveOrdering ordering = board->getMoveOrdering();
+                    ordering.learned = true;
+                    solver.setMoveOrdering(ordering);
+                    solver.setMoveModel(model.get());
+                }
+                solution = solver.findSolution(options.budget);
+                statistics = solver.getStatistics();
+                status = !solution.empty() ? "solved" : stopStatus(solver.getStopReason());
+            }
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            (status == "solved" ? solved : failed)++;
+
+            lock_guard<mutex> lock(outputMutex);
+            cout << number << '\t' << boardName << '\t' << status << '\t' << solution.size() << '\t'
+                << ms << '\t' << formatSolution(solution) << endl;
+            if (statistics.enabled) {
+                cerr << "# line " << number << endl;
+                statistics.writeReport(cerr);
+            }
+        }
+    };
+    vector<thread> threads;
+    for (int i = 0; i < options.jobs; ++i) threads.emplace_back(worker);
+    for (auto& t : threads) t.join();
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - batchStart).count();
+    int total = solved.load() + failed.load();
+    cerr << "pegsolve: " << total << " positions (" << solved.load() << " solved) in " << seconds << " s, "
+        << (seconds > 0 ? total / seconds : 0.0) << " positions/s" << endl;
+    return 0;
+}
@@ -0,0 +1,65 @@
+// pegtable: builds tablebase files
+//
+//     pegtable [--target pegs] [-o file] <board> <cells|start|full>
+//
+// <board> and <cells> are as in pegsolve. "full" tabulates every position of the board
+// (boards of up to Tablebase::MAX_FULL_CELLS holes); otherwise the table holds every position
+// reachable from the given one, which is how a level's table is made. The file is read back
+// and checked before the tool exits; TablebaseLibrary::load makes it available to the solver.
+#include "board.h"
+#include "tablebase.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    int target = 1;
+    string output = "tablebase.bin";
+    vector<string> positional;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--target" && i + 1 < argc) target = atoi(argv[++i]);
+        else if (arg == "-o" && i + 1 < argc) output = argv[++i];
+        else positional.push_back(arg);
+    }
+    unique_ptr<Board> board = positional.size() == 2 ? makeBoard(positional[0]) : nullptr;
+    if (!board || target < 1) {
+        cerr << "usage: pegtable [--target pegs] [-o file] <triangle|square|hexagon> <cells|start|full>" << endl;
+        return 2;
+    }
+    bool full = positional[1] == "full";
+    if (!full && !setCells(*board, positional[1])) {
+        cerr << "pegtable: " << positional[1] << " does not fit the " << positional[0] << " board" << endl;
+        return 2;
+    }
+
+    auto start = chrono::steady_clock::now();
+    unique_ptr<Tablebase> table = full ? Tablebase::buildFull(board->getGeometry(), target)
+        : Tablebase::buildReachable(board->toBitBoard(), target);
+    if (!table) {
+        cerr << "pegtable: the " << positional[0] << " board is too large for a full table" << endl;
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (!table->write(output)) {
+        cerr << "pegtable: cannot write " << output << endl;
+        return 1;
+    }
+
+    unique_ptr<Tablebase> check = Tablebase::open(output, board->getGeometry());
+    BitMask pegs = board->toBitBoard().getPegs();
+    vector<MoveIndex> path;
+    if (!check || check->size() != table->size()) {
+        cerr << "pegtable: " << output << " does not read back" << endl;
+        return 1;
+    }
+    bool solvable = check->solve(pegs, path);
+    cerr << "pegtable: " << table->size() << " positions in " << seconds << " s, written to " << output << endl;
+    if (!full) cerr << "pegtable: the start is " << (solvable ? "solvable in " + to_string(path.size()) + " moves" : string("unsolvable")) << endl;
+    return 0;
+}
@@ -0,0 +1,372 @@
+// pegtest: checks of the rules engine and the solver, run by ctest
+//
+//     pegtest <islands|movebatch|searches|store>
+//
+// islands    the flood-fill island count of AISolver against the breadth-first count it replaced
+// movebatch  every MoveBatch kernel this CPU runs against BitBoard::getAllPossibleMoves
+// searches   IDA*, depth-first and bidirectional search agree on seeded positions, the
+//            triangle's full tablebase referees, and pinned positions keep their answers
+// store      the solution store never rewrites a file that is not a store, skips torn records,
+//            and a cached solution is replayed before it is trusted
+// Positions come from fixed seeds, so a failure is reproduced by running the test again.
+// Files are written to the working directory.
+#include "ai_solver.h"
+#include "board.h"
+#include "dead_position_set.h"
+#include "move_batch.h"
+#include "solution_store.h"
+#include "tablebase.h"
+#include "transposition_table.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool ok, const string& what) {
+    if (ok) return;
+    cerr << "FAIL: " << what << endl;
+    ++failures;
+}
+
+static void setPegs(Board& board, BitMask pegs) {
+    const BoardGeometry& geometry = board.getGeometry();
+    for (int cell = 0; cell < geometry.getCellCount(); ++cell) {
+        Position p = geometry.getCellPosition(cell);
+        board.setPeg(p.x, p.y, (pegs & cellBit(cell)) ? 1 : 0);
+    }
+}
+
+static BitMask randomPegs(const BoardGeometry& geometry, mt19937_64& rng) {
+    // From sparse to nearly full boards
+    uniform_int_distribution<int> percent(5, 95);
+    int density = percent(rng);
+    BitMask pegs = 0;
+    for (int cell = 0; cell < geometry.getCellCount(); ++cell) {
+        if ((int)(rng() % 100) < density) pegs |= cellBit(cell);
+    }
+    return pegs;
+}
+
+// `moves` random jumps from the start, fewer where the game ends first
+static BitMask playedPegs(const Board& start, int moves, mt19937_64& rng) {
+    BitBoard board = start.toBitBoard();
+    for (int i = 0; i < moves; ++i) {
+        MoveList list;
+        board.getAllPossibleMoves(list);
+        if (list.empty()) break;
+        board.makeMove(list.moves[rng() % list.size]);
+    }
+    return board.getPegs();
+}
+
+static string slurp(const string& path) {
+    ifstream in(path, ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+// The heuristic as AISolver counted it before the flood fill: a breadth-first search over the
+// 16 cells within one step or one jump, through Board's virtual isValidPosition
+static int islandsByBfs(const Board* board) {
+    int islands = 0;
+    vector<vector<bool>> visited(board->getHeight(), vector<bool>(board->getWidth(), false));
+    for (int y = 0; y < board->getHeight(); ++y) {
+        for (int x = 0; x < board->getWidth(); ++x) {
+            if (board->getPeg(x, y) == 1 && !visited[y][x]) {
+                islands++;
+                queue<Position> q;
+                q.push({ x, y });
+                visited[y][x] = true;
+                while (!q.empty()) {
+                    Position current = q.front(); q.pop();
+                    int dx[] = { -1, 1, 0, 0, -1, -1, 1, 1, -2, 2, 0, 0, -2, -2, 2, 2 };
+                    int dy[] = { 0, 0, -1, 1, -1, 1, -1, 1,  0, 0, -2, 2, -2, 2, -2, 2 };
+                    for (int i = 0; i < 16; ++i) {
+                        int nx = current.x + dx[i], ny = current.y + dy[i];
+                        if (board->isValidPosition(nx, ny) && board->getPeg(nx, ny) == 1 && !visited[ny][nx]) {
+                            visited[ny][nx] = true; q.push({ nx, ny });
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return islands > 0 ? islands - 1 : 0;
+}
+
+static void testIslands() {
+    mt19937_64 rng(12);
+    for (const char* name : { "triangle", "square", "hexagon" }) {
+        unique_ptr<Board> board = makeBoard(name);
+        const BoardGeometry& geometry = board->getGeometry();
+        AISolver solver(board.get(), 1);
+        for (int i = 0; i < 3000; ++i) {
+            BitMask pegs = i % 2 ? randomPegs(geometry, rng) : playedPegs(*makeBoard(name), (int)(rng() % geometry.getCellCount()), rng);
+            setPegs(*board, pegs);
+            int expected = islandsByBfs(board.get());
+            int counted = solver.estimateCost(BitBoard(geometry, pegs));
+            check(counted == expected, string(name) + " islands of mask " + to_string(pegs) + ": " + to_string(counted) + ", expected " + to_string(expected));
+        }
+    }
+}
+
+static void testMoveBatch() {
+    mt19937_64 rng(13);
+    for (const char* name : { "triangle", "square", "hexagon" }) {
+        unique_ptr<Board> board = makeBoard(name);
+        const BoardGeometry& geometry = board->getGeometry();
+        AISolver solver(board.get(), 1);
+        MoveBatch batch(geometry);
+        for (MoveBatch::Kernel kernel : { MoveBatch::Kernel::Scalar, MoveBatch::Kernel::Sse2, MoveBatch::Kernel::Avx2 }) {
+            if (!MoveBatch::isSupported(kernel)) continue;
+            batch.setKernel(kernel);
+            string where = string(name) + " " + MoveBatch::kernelName(kernel);
+            for (int round = 0; round < 200; ++round) {
+                BitMask pegs[MoveBatch::MAX_LANES];
+                int lanes = 1 + round % MoveBatch::MAX_LANES;
+                for (int lane = 0; lane < lanes; ++lane) {
+                    pegs[lane] = lane % 2 ? randomPegs(geometry, rng) : playedPegs(*board, (int)(rng() % geometry.getCellCount()), rng);
+                }
+                batch.evaluate(pegs, lanes, true);
+                check(batch.size() == lanes, where + " batch size");
+                for (int lane = 0; lane < lanes; ++lane) {
+                    BitBoard position(geometry, pegs[lane]);
+                    MoveList expected, moves;
+                    position.getAllPossibleMoves(expected);
+                    batch.getMoves(lane, moves);
+                    BitMask movable = 0;
+                    for (MoveIndex move : expected) movable |= cellBit(geometry.getJump(move).from);
+                    string mask = where + " mask " + to_string(pegs[lane]);
+                    check(vector<MoveIndex>(moves.begin(), moves.end()) == vector<MoveIndex>(expected.begin(), expected.end()), mask + ": moves");
+                    check(batch.getMoveCount(lane) == expected.size, mask + ": move count");
+                    check(batch.getPegCount(lane) == position.getPegCount(), mask + ": peg count");
+                    check(batch.getMovable(lane) == movable, mask + ": movable pegs");
+                    check(batch.getHeuristic(lane) == solver.estimateCost(position), mask + ": islands");
+                }
+            }
+        }
+    }
+}
+
+struct SearchResult {
+    vector<Move> moves;
+    SearchStop stop = SearchStop::Finished;
+};
+
+// One search with its own tables and an empty store of its own, so no answer comes from cache
+static SearchResult solve(const Board& start, int target, SearchMode mode, int finishCell = -1) {
+    static const char* storePath = "pegtest_search.bin";
+    remove(storePath);
+    SearchResult result;
+    {
+        unique_ptr<Board> board = start.clone(false);
+        SolutionStore store(storePath);
+        TranspositionTable table(4);
+        DeadPositionSet deadPositions(4);
+        AISolver solver(board.get(), target);
+        solver.setLogStream(nullptr);
+        solver.setThreadCount(2);
+        solver.setSolutionStore(store);
+        solver.setTranspositionTable(table);
+        solver.setDeadPositionSet(deadPositions);
+        solver.setSearchMode(mode);
+        if (finishCell >= 0) {
+            Position p = start.getGeometry().getCellPosition(finishCell);
+            solver.setFinishHole(p.x, p.y);
+        }
+        SearchBudget budget;
+        budget.milliseconds = 60000;
+        result.moves = solver.findSolution(budget);
+        result.stop = solver.getStopReason();
+    }
+    remove(storePath);
+    return result;
+}
+
+// The moves are legal from `start` and leave at most `target` pegs, the last one on the finish hole
+static bool isSolution(const Board& start, const vector<Move>& moves, int target, int finishCell = -1) {
+    unique_ptr<Board> board = start.clone(false);
+    for (const Move& move : moves) {
+        if (!board->makeMove(move)) return false;
+    }
+    if (board->getPegCount() > target) return false;
+    if (finishCell < 0) return true;
+    Position p = start.getGeometry().getCellPosition(finishCell);
+    return board->getPeg(p.x, p.y) == 1;
+}
+
+static const char* modeName(SearchMode mode) {
+    switch (mode) {
+    case SearchMode::IterativeDeepening: return "IDA*";
+    case SearchMode::Bidirectional: return "bidirectional";
+    case SearchMode::DepthFirst: return "depth-first";
+    }
+    return "?";
+}
+
+// Every mode finds a solution of `start` exactly when `solvable`; -1 = whatever IDA* says
+static void crossCheck(const Board& start, int target, int solvable, const string& where, int finishCell = -1) {
+    vector<SearchMode> modes = { SearchMode::DepthFirst, SearchMode::Bidirectional };
+    // With a finish hole IDA* hands over to the bidirectional search
+    if (finishCell < 0) modes.insert(modes.begin(), SearchMode::IterativeDeepening);
+    for (SearchMode mode : modes) {
+        SearchResult result = solve(start, target, mode, finishCell);
+        string what = where + " " + modeName(mode);
+        check(result.stop == SearchStop::Finished, what + ": search did not finish");
+        if (solvable < 0) solvable = result.moves.empty() ? 0 : 1;
+        check(result.moves.empty() != (solvable == 1), what + (solvable ? ": no solution found" : ": solved an unsolvable position"));
+        if (!result.moves.empty()) {
+            check(isSolution(start, result.moves, target, finishCell), what + ": not a solution");
+            // Every jump removes one peg; with a finish hole fewer than `target` may be left
+            if (finishCell < 0) check((int)result.moves.size() == start.getPegCount() - target, what + ": solution of the wrong length");
+        }
+    }
+}
+
+static void testSearches() {
+    // Searches only: the triangle's table is built below as the referee
+    TablebaseLibrary::shared().setAutomaticBuild(false);
+
+    // Pinned: the depth-first search once cut this off by the island count and missed the one
+    // jump of the pair (either way) that leaves two pegs
+    unique_ptr<Board> pinned = makeBoard("square");
+    setCells(*pinned, "000000001100000000000000000000010");
+    for (SearchMode mode : { SearchMode::IterativeDeepening, SearchMode::DepthFirst, SearchMode::Bidirectional }) {
+        SearchResult result = solve(*pinned, 2, mode);
+        check(result.moves.size() == 1 && isSolution(*pinned, result.moves, 2),
+            string("pinned square position, target 2, ") + modeName(mode) + ": expected one jump");
+    }
+
+    // Triangle positions against the full tablebase
+    unique_ptr<Board> triangle = makeBoard("triangle");
+    unique_ptr<Tablebase> referee = Tablebase::buildFull(triangle->getGeometry(), 1);
+    check(referee != nullptr, "triangle tablebase");
+    mt19937_64 rng(14);
+    for (int i = 0; referee && i < 12; ++i) {
+        unique_ptr<Board> start = makeBoard("triangle");
+        setPegs(*start, playedPegs(*start, (int)(rng() % 6), rng));
+        uint8_t entry;
+        bool held = referee->lookup(start->toBitBoard().getPegs(), entry);
+        check(held, "triangle position not in the tablebase");
+        if (held) crossCheck(*start, 1, entry != Tablebase::UNSOLVABLE, "triangle position " + to_string(i));
+    }
+
+    // Square positions 16 to 20 jumps in, where every mode finishes in moments
+    for (int i = 0; i < 16; ++i) {
+        unique_ptr<Board> start = makeBoard("square");
+        setPegs(*start, playedPegs(*start, 16 + (int)(rng() % 5), rng));
+        crossCheck(*start, 1, -1, "square position " + to_string(i));
+    }
+    // and with the last peg to finish in the centre
+    int centre = makeBoard("square")->getGeometry().getCellIndex(3, 3);
+    for (int i = 0; i < 8; ++i) {
+        unique_ptr<Board> start = makeBoard("square");
+        setPegs(*start, playedPegs(*start, 18 + (int)(rng() % 4), rng));
+        crossCheck(*start, 1, -1, "square position " + to_string(i) + " finishing in the centre", centre);
+    }
+}
+
+static void testStore() {
+    // A file that is not a store is neither truncated nor rewritten, by open, insert or compact
+    const string other = "pegtest_not_a_store.txt";
+    {
+        ofstream out(other, ios::binary | ios::trunc);
+        for (int i = 0; i < 100; ++i) out << "line " << i << " of a file that is not a solution store\n";
+    }
+    string text = slurp(other);
+    {
+        SolutionStore store(other);
+        check(!store.isOpen(), "a text file opened as a solution store");
+        store.insert(1, 1, 100, { 1, 2, 3 });
+        store.flush();
+    }
+    check(slurp(other) == text, "opening a text file as a store changed it");
+    check(SolutionStore::compact(other) == -1, "compact accepted a text file");
+    check(slurp(other) == text, "compacting a text file changed it");
+    remove(other.c_str());
+
+    // A record torn by another process mid-append is skipped, the rest of the file kept
+    const string path = "pegtest_store.bin";
+    remove(path.c_str());
+    {
+        SolutionStore store(path);
+        check(store.isOpen(), "new solution store");
+        store.insert(1, 1, 100, { 1, 2, 3 });
+        store.flush();
+    }
+    {
+        ofstream out(path, ios::binary | ios::app);
+        out << string(20, '\x52');
+    }
+    {
+        SolutionStore store(path);
+        store.insert(1, 1, 200, { 4, 5 });
+        store.flush();
+    }
+    string bytes = slurp(path);
+    {
+        SolutionStore store(path);
+        vector<MoveIndex> first, second;
+        check(store.find(1, 1, 100, first) && first == vector<MoveIndex>{ 1, 2, 3 }, "record before a torn one lost");
+        check(store.find(1, 1, 200, second) && second == vector<MoveIndex>{ 4, 5 }, "record after a torn one lost");
+        check(store.size() == 2, "torn record counted");
+    }
+    check(slurp(path) == bytes, "opening a store with a torn record rewrote it");
+    check(SolutionStore::compact(path) == 2, "compact did not keep both records");
+    {
+        SolutionStore store(path);
+        vector<MoveIndex> second;
+        check(store.find(1, 1, 200, second) && second == vector<MoveIndex>{ 4, 5 }, "record lost by compact");
+    }
+    remove(path.c_str());
+
+    // A stored path that is not a solution is replayed, rejected and searched again
+    TablebaseLibrary::shared().setAutomaticBuild(false);
+    unique_ptr<Board> board = makeBoard("square");
+    setCells(*board, "000000001100000000000000000000010");
+    BitBoard position = board->toBitBoard();
+    {
+        SolutionStore store(path);
+        store.insert(position.getGeometry().getFingerprint(), 2, position.getCanonicalHash(), { 0 });
+        store.flush();
+    }
+    for (int run = 0; run < 2; ++run) {
+        SolutionStore store(path);
+        AISolver solver(board.get(), 2);
+        solver.setLogStream(nullptr);
+        solver.setSolutionStore(store);
+        solver.setStatisticsEnabled(true);
+        vector<Move> moves = solver.findSolution();
+        check(isSolution(*board, moves, 2), "cached path, run " + to_string(run) + ": not a solution");
+        const char* answeredBy = solver.getStatistics().answeredBy;
+        if (run == 0) {
+            check(solver.getHashCollisions() == 1, "a bogus cached path was not counted as a collision");
+            check(answeredBy == nullptr, "a bogus cached path was trusted");
+        }
+        // The search stored the real solution over the bogus one
+        else check(answeredBy && string(answeredBy) == "solution store", "the searched solution was not stored");
+    }
+    remove(path.c_str());
+}
+
+int main(int argc, char** argv) {
+    string test = argc == 2 ? argv[1] : "";
+    if (test == "islands") testIslands();
+    else if (test == "movebatch") testMoveBatch();
+    else if (test == "searches") testSearches();
+    else if (test == "store") testStore();
+    else {
+        cerr << "usage: pegtest <islands|movebatch|searches|store>" << endl;
+        return 2;
+    }
+    if (failures) cerr << test << ": " << failures << " failures" << endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,203 @@
+// pegtrain: fits a MoveModel to the layers peglayers wrote
+//
+//     pegtrain --dir path [-o file] [--samples n] [--epochs n] [--hidden n m] [--seed n] <board>
+//
+// Samples symmetry classes uniformly from the layers above the target, labels each with the
+// solvable files, and trains by Adam on the logistic loss; every epoch shows each sample under
+// a random symmetry, so the model rates every image of a position. A twentieth of the samples
+// is held out, and the loss and accuracy on it are printed after every epoch. The file is read
+// back and checked before the tool exits; pegsolve --model and pegbench --model use it.
+#include "board.h"
+#include "move_model.h"
+#include "position_layers.h"
+#include "symmetry.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct Sample {
+    BitMask pegs;
+    float label; // 1 = solvable
+};
+
+// Gradients of one batch and the Adam moments, laid out like MoveModel::getWeights
+class Trainer {
+public:
+    Trainer(MoveModel& m, float rate) : model(m), learningRate(rate),
+        gradient(m.getWeights().size()), firstMoment(m.getWeights().size()), secondMoment(m.getWeights().size()) {
+    }
+
+    // Loss of one sample; with `learn` its gradient is added to the batch
+    float step(BitMask pegs, float label, bool learn, bool& correct) {
+        const vector<float>& w = model.getWeights();
+        int h1 = model.getHidden1(), h2 = model.getHidden2();
+        float first[MoveModel::MAX_HIDDEN], second[MoveModel::MAX_HIDDEN];
+        for (int i = 0; i < h1; ++i) first[i] = w[model.firstBiasOffset() + i];
+        for (BitMask rest = pegs; rest; rest &= rest - 1) {
+            const float* row = &w[(size_t)lowestBit(rest) * h1];
+            for (int i = 0; i < h1; ++i) first[i] += row[i];
+        }
+        for (int j = 0; j < h2; ++j) {
+            float sum = w[model.secondBiasOffset() + j];
+            for (int i = 0; i < h1; ++i) sum += w[model.secondLayerOffset() + (size_t)j * h1 + i] * (std::max)(first[i], 0.0f);
+            second[j] = sum;
+        }
+        float logit = w[model.outputOffset() + h2];
+        for (int j = 0; j < h2; ++j) logit += w[model.outputOffset() + j] * (std::max)(second[j], 0.0f);
+        float p = 1.0f / (1.0f + exp(-logit));
+        correct = (p >= 0.5f) == (label >= 0.5f);
+        float loss = -(label * log((std::max)(p, 1e-7f)) + (1 - label) * log((std::max)(1 - p, 1e-7f)));
+        if (!learn) return loss;
+
+        // Backward
+        float out = p - label;
+        float secondDelta[MoveModel::MAX_HIDDEN], firstDelta[MoveModel::MAX_HIDDEN] = {};
+        gradient[model.outputOffset() + h2] += out;
+        for (int j = 0; j < h2; ++j) {
+            gradient[model.outputOffset() + j] += out * (std::max)(second[j], 0.0f);
+            secondDelta[j] = second[j] > 0 ? out * w[model.outputOffset() + j] : 0.0f;
+        }
+        for (int j = 0; j < h2; ++j) {
+            if (secondDelta[j] == 0) continue;
+            gradient[model.secondBiasOffset() + j] += secondDelta[j];
+            for (int i = 0; i < h1; ++i) {
+                size_t k = model.secondLayerOffset() + (size_t)j * h1 + i;
+                gradient[k] += secondDelta[j] * (std::max)(first[i], 0.0f);
+                firstDelta[i] += secondDelta[j] * w[k];
+            }
+        }
+        for (int i = 0; i < h1; ++i) {
+            if (first[i] <= 0) firstDelta[i] = 0;
+            gradient[model.firstBiasOffset() + i] += firstDelta[i];
+        }
+        for (BitMask rest = pegs; rest; rest &= rest - 1) {
+            float* row = &gradient[(size_t)lowestBit(rest) * h1];
+            for (int i = 0; i < h1; ++i) row[i] += firstDelta[i];
+        }
+        return loss;
+    }
+
+    // Adam over the mean gradient of `count` samples
+    void update(int count) {
+        vector<float>& w = model.getWeights();
+        ++steps;
+        float correction1 = 1 - pow(BETA1, (float)steps), correction2 = 1 - pow(BETA2, (float)steps);
+        for (size_t k = 0; k < w.size(); ++k) {
+            float g = gradient[k] / count;
+            firstMoment[k] = BETA1 * firstMoment[k] + (1 - BETA1) * g;
+            secondMoment[k] = BETA2 * secondMoment[k] + (1 - BETA2) * g * g;
+            w[k] -= learningRate * (firstMoment[k] / correction1) / (sqrt(secondMoment[k] / correction2) + 1e-8f);
+            gradient[k] = 0;
+        }
+    }
+
+private:
+    static constexpr float BETA1 = 0.9f, BETA2 = 0.999f;
+    MoveModel& model;
+    float learningRate;
+    vector<float> gradient, firstMoment, secondMoment;
+    long long steps = 0;
+};
+
+int main(int argc, char** argv) {
+    string directory, output = "model.pegmodel";
+    size_t sampleCount = 1 << 20;
+    int epochs = 4, hidden1 = 32, hidden2 = 16, batchSize = 256;
+    unsigned seed = 20250618;
+    vector<string> positional;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--dir" && i + 1 < argc) directory = argv[++i];
+        else if (arg == "-o" && i + 1 < argc) output = argv[++i];
+        else if (arg == "--samples" && i + 1 < argc) sampleCount = (size_t)(std::max)(100LL, atoll(argv[++i]));
+        else if (arg == "--epochs" && i + 1 < argc) epochs = (std::max)(1, atoi(argv[++i]));
+        else if (arg == "--hidden" && i + 2 < argc) {
+            hidden1 = atoi(argv[++i]);
+            hidden2 = atoi(argv[++i]);
+        }
+        else if (arg == "--seed" && i + 1 < argc) seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else positional.push_back(arg);
+    }
+    unique_ptr<Board> board = positional.size() == 1 ? makeBoard(positional[0]) : nullptr;
+    if (!board || directory.empty()) {
+        cerr << "usage: pegtrain --dir path [-o file] [--samples n] [--epochs n] [--hidden n m] [--seed n] <triangle|square|hexagon>" << endl;
+        return 2;
+    }
+    const BoardGeometry& geometry = board->getGeometry();
+    unique_ptr<PositionLayers> layers = PositionLayers::open(directory, geometry);
+    if (!layers) {
+        cerr << "pegtrain: no layers of the " << positional[0] << " board in " << directory << endl;
+        return 1;
+    }
+
+    // Uniform over the classes of the layers a search orders moves in
+    vector<const PositionLayers::Layer*> sources;
+    uint64_t classes = 0;
+    for (const PositionLayers::Layer& layer : layers->getLayers()) {
+        if (layer.pegs <= layers->getTarget()) continue;
+        sources.push_back(&layer);
+        classes += layer.classes;
+    }
+    if (classes == 0) {
+        cerr << "pegtrain: the layers in " << directory << " have nothing above the target" << endl;
+        return 1;
+    }
+    mt19937_64 rng(seed);
+    vector<Sample> samples(sampleCount);
+    size_t solvable = 0;
+    for (Sample& sample : samples) {
+        uint64_t index = rng() % classes;
+        size_t s = 0;
+        while (index >= sources[s]->classes) index -= sources[s++]->classes;
+        sample.pegs = layers->getClass(sources[s]->pegs, index);
+        sample.label = layers->isSolvable(sample.pegs) ? 1.0f : 0.0f;
+        solvable += sample.label > 0;
+    }
+    size_t heldOut = (std::max)((size_t)1, samples.size() / 20), training = samples.size() - heldOut;
+    cerr << "pegtrain: " << samples.size() << " samples of " << classes << " classes, " << solvable << " solvable" << endl;
+
+    MoveModel model(geometry, hidden1, hidden2, layers->getTarget(), seed);
+    Trainer trainer(model, 0.003f);
+    const SymmetryGroup& symmetries = geometry.getSymmetries();
+    for (int epoch = 1; epoch <= epochs; ++epoch) {
+        auto start = chrono::steady_clock::now();
+        shuffle(samples.begin(), samples.begin() + training, rng);
+        double trainingLoss = 0;
+        bool correct;
+        for (size_t i = 0; i < training; ++i) {
+            BitMask pegs = symmetries.apply((int)(rng() % symmetries.size()), samples[i].pegs);
+            trainingLoss += trainer.step(pegs, samples[i].label, true, correct);
+            if ((i + 1) % batchSize == 0 || i + 1 == training) trainer.update((int)((i % batchSize) + 1));
+        }
+        double loss = 0;
+        size_t right = 0;
+        for (size_t i = training; i < samples.size(); ++i) {
+            BitMask pegs = symmetries.apply((int)(rng() % symmetries.size()), samples[i].pegs);
+            loss += trainer.step(pegs, samples[i].label, false, correct);
+            right += correct;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cerr << "pegtrain: epoch " << epoch << ": training loss " << trainingLoss / training << ", held-out loss "
+            << loss / heldOut << ", accuracy " << 100.0 * right / heldOut << "%, " << seconds << " s" << endl;
+    }
+
+    if (!model.save(output)) {
+        cerr << "pegtrain: cannot write " << output << endl;
+        return 1;
+    }
+    unique_ptr<MoveModel> check = MoveModel::load(output, geometry);
+    if (!check || check->evaluate(samples[0].pegs) != model.evaluate(samples[0].pegs)) {
+        cerr << "pegtrain: " << output << " does not read back" << endl;
+        return 1;
+    }
+    cerr << "pegtrain: written to " << output << endl;
+    return 0;
+}
@@ -0,0 +1,589 @@
+#include "position_layers.h"
+#include "mapped_file.h"
+#include "move_batch.h"
+#include "symmetry.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <ostream>
+#include <queue>
+
+using namespace std;
+
+static const char FILE_MAGIC[8] = { 'P', 'E', 'G', 'L', 'A', 'Y', 'E', 'R' };
+static const uint32_t FILE_VERSION = 1;
+enum : uint32_t { KIND_REACH, KIND_SOLVE, KIND_RUN };
+
+// Parents read per round of expansion, and per task of a round
+static const size_t CHUNK_KEYS = 1 << 16;
+static const size_t TASK_KEYS = 1 << 12;
+// Runs merged at once; more are merged into longer runs first
+static const size_t MAX_FAN_IN = 64;
+static const size_t IO_BUFFER_BYTES = 1 << 16;
+// Kept out of the collection budget for the chunk being expanded, its children and the I/O buffers
+static const size_t RESERVED_BYTES = size_t(16) << 20;
+
+#pragma pack(push, 1)
+struct LayerHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t kind;
+    uint32_t pegs;
+    uint32_t target;
+    uint64_t geometry;      // BoardGeometry::getFingerprint
+    uint64_t keyCount;
+    uint64_t positionCount; // keys with every image counted
+    uint64_t indexOffset;   // of the block index, from the start of the file
+    uint64_t checksum;      // of the fields above
+};
+struct BlockIndex {
+    uint64_t firstKey;
+    uint64_t offset;        // from the first data byte
+};
+#pragma pack(pop)
+static_assert(sizeof(LayerHeader) == 64, "LayerHeader is part of the file format");
+
+// FNV-1a, as in the solution store
+static uint64_t checksum(const void* data, size_t bytes) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < bytes; ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static BitMask smallestImage(const SymmetryGroup& symmetries, BitMask pegs) {
+    BitMask best = pegs;
+    for (int t = 1; t < symmetries.size(); ++t) best = (std::min)(best, symmetries.apply(t, pegs));
+    return best;
+}
+
+// Distinct images of a position: the group size over the transforms that fix it
+static uint64_t orbitSize(const SymmetryGroup& symmetries, BitMask pegs) {
+    int fixed = 1;
+    for (int t = 1; t < symmetries.size(); ++t) fixed += symmetries.apply(t, pegs) == pegs;
+    return (uint64_t)(symmetries.size() / fixed);
+}
+
+static string layerPath(const string& directory, const char* name, int number) {
+    char file[32];
+    snprintf(file, sizeof(file), "%s-%02d.pegl", name, number);
+    return directory + "/" + file;
+}
+
+static bool validHeader(const LayerHeader& header, uint32_t kind, uint64_t geometry) {
+    return memcmp(header.magic, FILE_MAGIC, 8) == 0 && header.version == FILE_VERSION &&
+        header.checksum == checksum(&header, offsetof(LayerHeader, checksum)) &&
+        header.kind == kind && header.geometry == geometry &&
+        header.indexOffset >= sizeof(LayerHeader);
+}
+
+static uint64_t blockCount(uint64_t keys) {
+    return (keys + PositionLayers::BLOCK_KEYS - 1) / PositionLayers::BLOCK_KEYS;
+}
+
+// Writes keys in ascending order; a key equal to the previous one is dropped
+class LayerWriter {
+public:
+    bool open(const string& file, uint32_t kind, int pegs, int target, uint64_t geometry) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, FILE_MAGIC, 8);
+        header.version = FILE_VERSION;
+        header.kind = kind;
+        header.pegs = (uint32_t)pegs;
+        header.target = (uint32_t)target;
+        header.geometry = geometry;
+        out.open(file, ios::binary | ios::trunc);
+        // Rewritten with the counts by finish
+        out.write((const char*)&header, sizeof(header));
+        return (bool)out;
+    }
+
+    void add(BitMask key, uint64_t positions = 0) {
+        if (header.keyCount > 0 && key == last) return;
+        bool blockStart = header.keyCount % PositionLayers::BLOCK_KEYS == 0;
+        if (blockStart) index.push_back({ key, dataBytes + buffer.size() });
+        uint64_t delta = key - (blockStart ? 0 : last);
+        do {
+            uint8_t byte = (uint8_t)(delta & 0x7F);
+            delta >>= 7;
+            buffer.push_back(delta ? byte | 0x80 : byte);
+        } while (delta);
+        last = key;
+        ++header.keyCount;
+        header.positionCount += positions;
+        if (buffer.size() >= IO_BUFFER_BYTES) flush();
+    }
+
+    uint64_t size() const { return header.keyCount; }
+    uint64_t getPositionCount() const { return header.positionCount; }
+
+    bool finish() {
+        flush();
+        header.indexOffset = sizeof(header) + dataBytes;
+        header.checksum = checksum(&header, offsetof(LayerHeader, checksum));
+        out.write((const char*)index.data(), (streamsize)(index.size() * sizeof(BlockIndex)));
+        out.seekp(0);
+        out.write((const char*)&header, sizeof(header));
+        out.close();
+        return !out.fail();
+    }
+
+private:
+    ofstream out;
+    LayerHeader header;
+    vector<BlockIndex> index;
+    vector<uint8_t> buffer;
+    uint64_t dataBytes = 0;
+    BitMask last = 0;
+
+    void flush() {
+        out.write((const char*)buffer.data(), (streamsize)buffer.size());
+        dataBytes += buffer.size();
+        buffer.clear();
+    }
+};
+
+// Streams the keys of a layer file in order
+class LayerReader {
+public:
+    bool open(const string& file, uint32_t kind, uint64_t geometry) {
+        in.open(file, ios::binary);
+        if (!in.read((char*)&header, sizeof(header)) || !validHeader(header, kind, geometry)) return false;
+        dataLeft = header.indexOffset - sizeof(header);
+        buffer.resize(IO_BUFFER_BYTES);
+        return true;
+    }
+
+    const LayerHeader& getHeader() const { return header; }
+
+    bool next(BitMask& key) {
+        if (keysRead == header.keyCount) return false;
+        uint64_t delta = 0;
+        int shift = 0;
+        uint8_t byte;
+        do {
+            if (position == end && !refill()) return false;
+            byte = buffer[position++];
+            if (shift < 64) delta |= (uint64_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        key = (keysRead % PositionLayers::BLOCK_KEYS == 0 ? 0 : last) + delta;
+        last = key;
+        ++keysRead;
+        return true;
+    }
+
+    // Up to `count` keys; fewer only at the end of the layer
+    size_t read(vector<BitMask>& keys, size_t count) {
+        keys.clear();
+        BitMask key;
+        while (keys.size() < count && next(key)) keys.push_back(key);
+        return keys.size();
+    }
+
+private:
+    ifstream in;
+    LayerHeader header;
+    vector<uint8_t> buffer;
+    size_t position = 0, end = 0;
+    uint64_t dataLeft = 0, keysRead = 0;
+    BitMask last = 0;
+
+    bool refill() {
+        size_t bytes = (size_t)(std::min)((uint64_t)buffer.size(), dataLeft);
+        if (bytes == 0 || !in.read((char*)buffer.data(), (streamsize)bytes)) return false;
+        dataLeft -= bytes;
+        position = 0;
+        end = bytes;
+        return true;
+    }
+};
+
+// The keys of one pass. They are collected up to `capacity`, then sorted in parallel slices and
+// spilled as run files; merge hands them back in order without duplicates.
+class RunCollector {
+public:
+    RunCollector(const string& dir, size_t capacity, WorkStealingPool& workers, uint64_t fingerprint)
+        : directory(dir), capacity(capacity), pool(workers), geometry(fingerprint) {
+        buffer.reserve(capacity);
+    }
+    ~RunCollector() {
+        for (const string& run : runs) remove(run.c_str());
+    }
+
+    bool add(const vector<BitMask>& keys) {
+        for (size_t i = 0; i < keys.size();) {
+            size_t count = (std::min)(keys.size() - i, capacity - buffer.size());
+            buffer.insert(buffer.end(), keys.begin() + i, keys.begin() + i + count);
+            i += count;
+            if (buffer.size() == capacity && !spill()) return false;
+        }
+        return true;
+    }
+
+    size_t getRunCount() const { return runsWritten; }
+
+    bool merge(const function<void(BitMask)>& emit) {
+        // Everything fitted: no run touches the disk
+        if (runs.empty()) {
+            vector<size_t> bounds, ends;
+            sortSlices(1, bounds, ends);
+            for (size_t i = 0; i < ends[0]; ++i) emit(buffer[i]);
+            buffer.clear();
+            return true;
+        }
+        if (!buffer.empty() && !spill()) return false;
+        // Everything is on disk; the buffer's memory goes to the merge
+        vector<BitMask>().swap(buffer);
+        while (runs.size() > MAX_FAN_IN) {
+            vector<string> inputs(runs.begin(), runs.begin() + MAX_FAN_IN);
+            runs.erase(runs.begin(), runs.begin() + MAX_FAN_IN);
+            string output = nextRunPath();
+            LayerWriter writer;
+            bool written = writer.open(output, KIND_RUN, 0, 0, geometry) &&
+                mergeRuns(inputs, [&](BitMask key) { writer.add(key); }) && writer.finish();
+            for (const string& run : inputs) remove(run.c_str());
+            runs.push_back(output);
+            if (!written) return false;
+        }
+        return mergeRuns(runs, emit);
+    }
+
+private:
+    string directory;
+    size_t capacity;
+    WorkStealingPool& pool;
+    uint64_t geometry;
+    vector<BitMask> buffer;
+    vector<string> runs;
+    size_t runsWritten = 0;
+
+    string nextRunPath() {
+        return layerPath(directory, "run", (int)runsWritten++);
+    }
+
+    // Sorts `slices` equal parts of the buffer on the pool, each without duplicates; part s
+    // starts at bounds[s] and now ends at ends[s]
+    void sortSlices(size_t slices, vector<size_t>& bounds, vector<size_t>& ends) {
+        bounds.resize(slices + 1);
+        ends.resize(slices);
+        for (size_t s = 0; s <= slices; ++s) bounds[s] = buffer.size() * s / slices;
+        WorkStealingPool::TaskGroup group;
+        for (size_t s = 0; s < slices; ++s) {
+            pool.submit(group, [this, s, &bounds, &ends] {
+                auto first = buffer.begin() + bounds[s];
+                sort(first, buffer.begin() + bounds[s + 1]);
+                ends[s] = unique(first, buffer.begin() + bounds[s + 1]) - buffer.begin();
+            });
+        }
+        group.wait();
+    }
+
+    bool spill() {
+        size_t slices = (size_t)pool.getThreadCount();
+        if (buffer.size() < slices * TASK_KEYS) slices = 1;
+        vector<size_t> bounds, ends;
+        sortSlices(slices, bounds, ends);
+        bool written = true;
+        for (size_t s = 0; s < slices; ++s) {
+            string output = nextRunPath();
+            LayerWriter writer;
+            written = written && writer.open(output, KIND_RUN, 0, 0, geometry);
+            for (size_t i = bounds[s]; written && i < ends[s]; ++i) writer.add(buffer[i]);
+            written = written && writer.finish();
+            runs.push_back(output);
+        }
+        buffer.clear();
+        return written;
+    }
+
+    bool mergeRuns(const vector<string>& inputs, const function<void(BitMask)>& emit) {
+        vector<unique_ptr<LayerReader>> readers;
+        typedef pair<BitMask, size_t> Head;
+        priority_queue<Head, vector<Head>, greater<Head>> heads;
+        for (const string& run : inputs) {
+            readers.emplace_back(new LayerReader());
+            if (!readers.back()->open(run, KIND_RUN, geometry)) return false;
+            BitMask key;
+            if (readers.back()->next(key)) heads.push({ key, readers.size() - 1 });
+        }
+        uint64_t merged = 0;
+        BitMask last = 0;
+        while (!heads.empty()) {
+            Head head = heads.top();
+            heads.pop();
+            if (merged++ == 0 || head.first != last) emit(head.first);
+            last = head.first;
+            BitMask key;
+            if (readers[head.second]->next(key)) heads.push({ key, head.second });
+        }
+        return true;
+    }
+};
+
+struct PositionLayers::LayerFile {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    void* handle = nullptr;
+    LayerHeader header;
+
+    ~LayerFile() { unmapFile(data, size, handle); }
+
+    static unique_ptr<LayerFile> open(const string& file, uint32_t kind, uint64_t geometry) {
+        unique_ptr<LayerFile> layer(new LayerFile());
+        layer->data = mapFile(file, layer->size, layer->handle);
+        if (!layer->data || layer->size < sizeof(LayerHeader)) return nullptr;
+        memcpy(&layer->header, layer->data, sizeof(LayerHeader));
+        const LayerHeader& header = layer->header;
+        if (!validHeader(header, kind, geometry) || header.indexOffset > layer->size ||
+            (layer->size - header.indexOffset) / sizeof(BlockIndex) != blockCount(header.keyCount) ||
+            (layer->size - header.indexOffset) % sizeof(BlockIndex) != 0) return nullptr;
+        return layer;
+    }
+
+    BlockIndex block(uint64_t i) const {
+        BlockIndex entry;
+        memcpy(&entry, data + header.indexOffset + i * sizeof(BlockIndex), sizeof(entry));
+        return entry;
+    }
+
+    // Decodes block `b` until `stop` returns true for a key, which is returned; 0 if none does
+    template <class Stop>
+    BitMask decode(uint64_t b, Stop stop) const {
+        const uint8_t* p = data + sizeof(LayerHeader) + block(b).offset;
+        const uint8_t* end = data + header.indexOffset;
+        uint64_t count = (std::min)((uint64_t)BLOCK_KEYS, header.keyCount - b * BLOCK_KEYS);
+        BitMask current = 0;
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t delta = 0;
+            for (int shift = 0; p < end; shift += 7) {
+                uint8_t byte = *p++;
+                if (shift < 64) delta |= (uint64_t)(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) break;
+            }
+            current += delta;
+            if (stop(current, i)) return current;
+        }
+        return 0;
+    }
+
+    BitMask at(uint64_t index) const {
+        if (index >= header.keyCount) return 0;
+        uint64_t offset = index % BLOCK_KEYS;
+        return decode(index / BLOCK_KEYS, [offset](BitMask, uint64_t i) { return i == offset; });
+    }
+
+    bool contains(BitMask key) const {
+        uint64_t blocks = blockCount(header.keyCount);
+        // The last block whose first key is not above `key`
+        uint64_t low = 0, high = blocks;
+        while (low < high) {
+            uint64_t middle = low + (high - low) / 2;
+            if (block(middle).firstKey <= key) low = middle + 1;
+            else high = middle;
+        }
+        if (low == 0) return false;
+        // Layers end at one peg, so no key is 0
+        return decode(low - 1, [key](BitMask current, uint64_t) { return current >= key; }) == key;
+    }
+};
+
+// Every child of a chunk of parents, or every parent of a chunk of children, as smallest images
+static void expandChunk(const BoardGeometry& geometry, const vector<BitMask>& keys, bool backward,
+    WorkStealingPool& pool, vector<vector<BitMask>>& results) {
+    const SymmetryGroup& symmetries = geometry.getSymmetries();
+    size_t tasks = (keys.size() + TASK_KEYS - 1) / TASK_KEYS;
+    results.resize(tasks);
+    WorkStealingPool::TaskGroup group;
+    for (size_t t = 0; t < tasks; ++t) {
+        pool.submit(group, [&, t] {
+            vector<BitMask>& out = results[t];
+            out.clear();
+            size_t first = t * TASK_KEYS, last = (std::min)(keys.size(), first + TASK_KEYS);
+            if (backward) {
+                // A parent had pegs on `from` and `over` where the child has only `to`
+                for (size_t i = first; i < last; ++i) {
+                    for (int move = 0; move < geometry.getJumpCount(); ++move) {
+                        const Jump& jump = geometry.getJump((MoveIndex)move);
+                        if ((keys[i] & jump.mask) == cellBit(jump.to)) out.push_back(smallestImage(symmetries, keys[i] ^ jump.mask));
+                    }
+                }
+                return;
+            }
+            MoveBatch batch(geometry);
+            MoveList moves;
+            for (size_t i = first; i < last; i += MoveBatch::MAX_LANES) {
+                int count = (int)(std::min)(last - i, (size_t)MoveBatch::MAX_LANES);
+                batch.evaluate(&keys[i], count, false);
+                for (int lane = 0; lane < count; ++lane) {
+                    batch.getMoves(lane, moves);
+                    for (int m = 0; m < moves.size; ++m) {
+                        out.push_back(smallestImage(symmetries, keys[i + lane] ^ geometry.getJump(moves.moves[m]).mask));
+                    }
+                }
+            }
+        });
+    }
+    group.wait();
+}
+
+// Streams `input` through expandChunk into a collector
+static bool collect(const BoardGeometry& geometry, LayerReader& input, bool backward, WorkStealingPool& pool, RunCollector& output) {
+    vector<BitMask> chunk;
+    vector<vector<BitMask>> results;
+    while (input.read(chunk, CHUNK_KEYS) > 0) {
+        expandChunk(geometry, chunk, backward, pool, results);
+        for (const vector<BitMask>& keys : results) {
+            if (!output.add(keys)) return false;
+        }
+    }
+    return true;
+}
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+bool PositionLayers::build(const BitBoard& start, const LayerBuildOptions& options, ostream* log) {
+    const BoardGeometry& geometry = start.getGeometry();
+    const SymmetryGroup& symmetries = geometry.getSymmetries();
+    uint64_t fingerprint = geometry.getFingerprint();
+    WorkStealingPool pool(options.threads);
+    size_t capacity = (std::max)(CHUNK_KEYS,
+        (options.memoryBytes > RESERVED_BYTES ? options.memoryBytes - RESERVED_BYTES : 0) / sizeof(BitMask));
+    int top = start.getPegCount(), lowest = top;
+
+    LayerWriter first;
+    if (!first.open(layerPath(options.directory, "reach", top), KIND_REACH, top, options.target, fingerprint)) return false;
+    BitMask key = smallestImage(symmetries, start.getPegs());
+    first.add(key, orbitSize(symmetries, key));
+    if (!first.finish()) return false;
+
+    // Forward: reach-(k-1) from reach-k, until a layer is empty
+    for (int pegs = top; pegs > 1; --pegs) {
+        auto started = chrono::steady_clock::now();
+        LayerReader parents;
+        RunCollector children(options.directory, capacity, pool, fingerprint);
+        LayerWriter next;
+        string path = layerPath(options.directory, "reach", pegs - 1);
+        if (!parents.open(layerPath(options.directory, "reach", pegs), KIND_REACH, fingerprint) ||
+            !collect(geometry, parents, false, pool, children) ||
+            !next.open(path, KIND_REACH, pegs - 1, options.target, fingerprint) ||
+            !children.merge([&](BitMask child) { next.add(child, orbitSize(symmetries, child)); }) ||
+            !next.finish()) return false;
+        if (next.size() == 0) {
+            remove(path.c_str());
+            break;
+        }
+        lowest = pegs - 1;
+        if (log) {
+            *log << "reach " << pegs - 1 << ": " << next.size() << " classes, " << next.getPositionCount() << " positions, "
+                << children.getRunCount() << " runs, " << secondsSince(started) << " s" << endl;
+        }
+    }
+
+    // Backward: solve-k is reach-k up to the target, then the parents of solve-(k-1) in reach-k
+    for (int pegs = lowest; pegs <= top; ++pegs) {
+        auto started = chrono::steady_clock::now();
+        LayerReader reached;
+        LayerWriter solvable;
+        if (!reached.open(layerPath(options.directory, "reach", pegs), KIND_REACH, fingerprint) ||
+            !solvable.open(layerPath(options.directory, "solve", pegs), KIND_SOLVE, pegs, options.target, fingerprint)) return false;
+        if (pegs <= options.target) {
+            while (reached.next(key)) solvable.add(key, orbitSize(symmetries, key));
+        } else if (pegs > lowest) {
+            LayerReader children;
+            RunCollector parents(options.directory, capacity, pool, fingerprint);
+            bool more = reached.next(key);
+            if (!children.open(layerPath(options.directory, "solve", pegs - 1), KIND_SOLVE, fingerprint) ||
+                !collect(geometry, children, true, pool, parents) ||
+                !parents.merge([&](BitMask parent) {
+                    while (more && key < parent) more = reached.next(key);
+                    if (more && key == parent) solvable.add(key, orbitSize(symmetries, key));
+                })) return false;
+        }
+        if (!solvable.finish()) return false;
+        if (log) {
+            *log << "solve " << pegs << ": " << solvable.size() << " classes, " << solvable.getPositionCount() << " positions, "
+                << secondsSince(started) << " s" << endl;
+        }
+    }
+    return true;
+}
+
+PositionLayers::PositionLayers(const BoardGeometry& g) : geometry(g), target(1), reachFiles(65), solveFiles(65) {
+}
+
+PositionLayers::~PositionLayers() {
+}
+
+unique_ptr<PositionLayers> PositionLayers::open(const string& directory, const BoardGeometry& geometry) {
+    unique_ptr<PositionLayers> result(new PositionLayers(geometry));
+    uint64_t fingerprint = geometry.getFingerprint();
+    for (int pegs = geometry.getCellCount(); pegs >= 0; --pegs) {
+        unique_ptr<LayerFile> reach = LayerFile::open(layerPath(directory, "reach", pegs), KIND_REACH, fingerprint);
+        unique_ptr<LayerFile> solve = LayerFile::open(layerPath(directory, "solve", pegs), KIND_SOLVE, fingerprint);
+        if (!reach || !solve) {
+            // Layers are contiguous; a gap below the start ends them
+            if (result->layers.empty()) continue;
+            break;
+        }
+        Layer layer;
+        layer.pegs = pegs;
+        layer.classes = reach->header.keyCount;
+        layer.positions = reach->header.positionCount;
+        layer.solvableClasses = solve->header.keyCount;
+        layer.solvablePositions = solve->header.positionCount;
+        layer.bytes = reach->size + solve->size;
+        result->target = (int)solve->header.target;
+        result->layers.push_back(layer);
+        result->reachFiles[pegs] = move(reach);
+        result->solveFiles[pegs] = move(solve);
+    }
+    if (result->layers.empty()) return nullptr;
+    return result;
+}
+
+const PositionLayers::LayerFile* PositionLayers::fileOf(const vector<unique_ptr<LayerFile>>& files, BitMask pegs) const {
+    return files[popCount(pegs)].get();
+}
+
+bool PositionLayers::contains(BitMask pegs) const {
+    const LayerFile* file = fileOf(reachFiles, pegs);
+    return file && file->contains(smallestImage(geometry.getSymmetries(), pegs));
+}
+
+bool PositionLayers::isSolvable(BitMask pegs) const {
+    const LayerFile* file = fileOf(solveFiles, pegs);
+    return file && file->contains(smallestImage(geometry.getSymmetries(), pegs));
+}
+
+bool PositionLayers::solve(BitMask pegs, vector<MoveIndex>& path) const {
+    path.clear();
+    if (!isSolvable(pegs)) return false;
+    while (popCount(pegs) > target) {
+        bool found = false;
+        for (int move = 0; move < geometry.getJumpCount() && !found; ++move) {
+            const Jump& jump = geometry.getJump((MoveIndex)move);
+            if ((pegs & jump.mask) == (jump.mask & ~cellBit(jump.to)) && isSolvable(pegs ^ jump.mask)) {
+                path.push_back((MoveIndex)move);
+                pegs ^= jump.mask;
+                found = true;
+            }
+        }
+        if (!found) return false;
+    }
+    return true;
+}
+
+BitMask PositionLayers::getClass(int pegs, uint64_t index) const {
+    const LayerFile* file = pegs >= 0 && pegs < (int)reachFiles.size() ? reachFiles[pegs].get() : nullptr;
+    return file ? file->at(index) : 0;
+}
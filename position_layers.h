@@ -0,0 +1,82 @@
+// position_layers.h
+#ifndef POSITION_LAYERS_H
+#define POSITION_LAYERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bitboard.h"
+
+struct LayerBuildOptions {
+    std::string directory = ".";
+    std::size_t memoryBytes = std::size_t(1) << 30; // positions collected before a spill to disk, and the merge buffers
+    int threads = 0; // 0 = one per hardware thread
+    int target = 1;  // pegs a solvable position can be played down to
+};
+
+// Every position reachable from one start, enumerated breadth first and kept on disk, with the
+// solvable ones found by a second, backward pass. For boards whose reachable set does not fit in
+// memory, such as the 33-hole cross.
+//
+// Every jump removes one peg, so the positions with k pegs are exactly one BFS layer. Layer k is
+// two files in the directory: reach-k.pegl holds its reachable symmetry classes, solve-k.pegl
+// those from which `target` pegs can be reached. A file is a sorted list of canonical peg masks
+// (the smallest symmetric image), delta coded as LEB128 varints in blocks of BLOCK_KEYS keys,
+// with the first key of every block in an index at the end: a layer streams in order into the
+// next pass, and a lookup decodes one block of a mapped file.
+//
+// No layer is ever held in memory. Children are collected up to the RAM budget, sorted in
+// parallel slices and spilled as run files, and the runs are merged without duplicates into the
+// next layer. The backward pass collects the parents of solve-(k-1) the same way and keeps those
+// that are in reach-k.
+class PositionLayers {
+public:
+    static const int BLOCK_KEYS = 1024;
+
+    struct Layer {
+        int pegs = 0;
+        std::uint64_t classes = 0;         // reachable symmetry classes
+        std::uint64_t positions = 0;       // reachable positions, every image counted
+        std::uint64_t solvableClasses = 0;
+        std::uint64_t solvablePositions = 0;
+        std::uint64_t bytes = 0;           // of both files
+    };
+
+    // Writes the layers of every position reachable from `start`; false on an I/O error.
+    // Progress goes to `log` unless it is nullptr.
+    static bool build(const BitBoard& start, const LayerBuildOptions& options, std::ostream* log = nullptr);
+    // Maps the files build wrote; nullptr if they are missing, damaged or of another geometry
+    static std::unique_ptr<PositionLayers> open(const std::string& directory, const BoardGeometry& geometry);
+    ~PositionLayers();
+    PositionLayers(const PositionLayers&) = delete;
+    PositionLayers& operator=(const PositionLayers&) = delete;
+
+    const BoardGeometry& getGeometry() const { return geometry; }
+    int getTarget() const { return target; }
+    // From the start down to the last non-empty layer
+    const std::vector<Layer>& getLayers() const { return layers; }
+    // Reachable from the start
+    bool contains(BitMask pegs) const;
+    // Reachable from the start and solvable; positions the start never reaches are not known
+    bool isSolvable(BitMask pegs) const;
+    // A solution of a reachable, solvable position, one jump into a solvable child at a time
+    bool solve(BitMask pegs, std::vector<MoveIndex>& path) const;
+    // Class `index` of the layer with `pegs` pegs, in key order (0 past the end); for sampling
+    BitMask getClass(int pegs, std::uint64_t index) const;
+
+private:
+    struct LayerFile;
+
+    const BoardGeometry& geometry;
+    int target;
+    std::vector<Layer> layers;
+    std::vector<std::unique_ptr<LayerFile>> reachFiles, solveFiles; // [pegs]
+
+    explicit PositionLayers(const BoardGeometry& geometry);
+    const LayerFile* fileOf(const std::vector<std::unique_ptr<LayerFile>>& files, BitMask pegs) const;
+};
+
+#endif // POSITION_LAYERS_H
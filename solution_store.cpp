@@ -0,0 +1,295 @@
+#include "solution_store.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <tuple>
+
+using namespace std;
+
+const char* const SolutionStore::DEFAULT_PATH = "peg_solutions.bin";
+
+static const char FILE_MAGIC[8] = { 'P', 'E', 'G', 'S', 'O', 'L', 'V', 'E' };
+static const uint32_t FILE_VERSION = 1;
+static const uint32_t RECORD_MAGIC = 0x31434552; // "REC1"
+
+static size_t padded(size_t bytes) { return (bytes + 7) & ~(size_t)7; }
+
+SolutionStore::SolutionStore(const string& path)
+    : filePath(path), mapped(nullptr), mappedSize(0), mapHandle(nullptr), index(nullptr), indexCount(0),
+    opened(false), writing(false), stopping(false) {
+    open();
+    writer = thread(&SolutionStore::writerLoop, this);
+}
+
+SolutionStore::~SolutionStore() {
+    {
+        lock_guard<mutex> lock(writeMutex);
+        stopping = true;
+    }
+    writeReady.notify_all();
+    writer.join();
+    unmap();
+}
+
+SolutionStore& SolutionStore::shared() {
+    static SolutionStore store;
+    return store;
+}
+
+uint64_t SolutionStore::checksum(const void* data, size_t bytes, uint64_t seed) {
+    // FNV-1a, chained through `seed`
+    uint64_t hash = seed ^ 0xCBF29CE484222325ULL;
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < bytes; ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+vector<uint8_t> SolutionStore::encodeRecord(uint64_t geometry, int target, uint64_t key, const vector<MoveIndex>& path) {
+    RecordHeader header = {};
+    header.magic = RECORD_MAGIC;
+    header.length = (uint16_t)path.size();
+    header.target = (uint8_t)target;
+    header.geometry = geometry;
+    header.key = key;
+    header.checksum = checksum(path.data(), path.size(), checksum(&header, offsetof(RecordHeader, checksum)));
+    vector<uint8_t> bytes(padded(sizeof(RecordHeader) + path.size()), 0);
+    memcpy(bytes.data(), &header, sizeof(header));
+    if (!path.empty()) memcpy(bytes.data() + sizeof(header), path.data(), path.size());
+    return bytes;
+}
+
+size_t SolutionStore::validRecord(const uint8_t* data, size_t size, size_t offset) {
+    if (offset + sizeof(RecordHeader) > size) return 0;
+    RecordHeader header;
+    memcpy(&header, data + offset, sizeof(header));
+    if (header.magic != RECORD_MAGIC) return 0;
+    size_t bytes = padded(sizeof(RecordHeader) + header.length);
+    if (offset + bytes > size) return 0;
+    uint64_t sum = checksum(data + offset + sizeof(RecordHeader), header.length, checksum(&header, offsetof(RecordHeader, checksum)));
+    return sum == header.checksum ? bytes : 0;
+}
+
+void SolutionStore::unmap() {
+    unmapFile(mapped, mappedSize, mapHandle);
+    mapped = nullptr;
+    mappedSize = 0;
+    mapHandle = nullptr;
+    index = nullptr;
+    indexCount = 0;
+}
+
+void SolutionStore::open() {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        mapped = mapFile(filePath, mappedSize, mapHandle);
+        FileHeader header;
+        bool valid = mapped && mappedSize >= sizeof(header);
+        if (valid) {
+            memcpy(&header, mapped, sizeof(header));
+            valid = memcmp(header.magic, FILE_MAGIC, 8) == 0 && header.version == FILE_VERSION &&
+                header.checksum == checksum(&header, offsetof(FileHeader, checksum)) &&
+                header.indexOffset >= sizeof(header) && header.indexOffset <= mappedSize &&
+                header.indexCount <= (mappedSize - header.indexOffset) / sizeof(IndexEntry);
+        }
+        if (!valid) {
+            // No file yet, or an empty one: compact writes a new store. Anything else is left
+            // alone and the store stays closed.
+            unmap();
+            if (compact(filePath) < 0) return;
+            continue;
+        }
+        opened = true;
+        index = (const IndexEntry*)(mapped + header.indexOffset);
+        indexCount = (size_t)header.indexCount;
+
+        // A record that fails its checksum may be another process's append still under way, so it
+        // is skipped rather than cut off. What follows a torn record need not be aligned, so the
+        // scan moves on a byte at a time until a record checks out again.
+        size_t offset = (size_t)header.indexOffset + indexCount * sizeof(IndexEntry);
+        while (offset + sizeof(RecordHeader) <= mappedSize) {
+            size_t bytes = validRecord(mapped, mappedSize, offset);
+            if (!bytes) {
+                ++offset;
+                continue;
+            }
+            RecordHeader record;
+            memcpy(&record, mapped + offset, sizeof(record));
+            auto range = tail.equal_range(record.key);
+            auto existing = find_if(range.first, range.second, [&](const pair<const uint64_t, size_t>& e) {
+                RecordHeader earlier;
+                memcpy(&earlier, mapped + e.second, sizeof(earlier));
+                return earlier.geometry == record.geometry && earlier.target == record.target;
+            });
+            if (existing != range.second) existing->second = offset;
+            else tail.emplace(record.key, offset);
+            offset += bytes;
+        }
+        return;
+    }
+}
+
+bool SolutionStore::find(uint64_t geometry, int target, uint64_t key, vector<MoveIndex>& path) const {
+    {
+        lock_guard<mutex> lock(logMutex);
+        auto range = inserted.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second.geometry == geometry && it->second.target == target) {
+                path = it->second.path;
+                return true;
+            }
+        }
+    }
+    // tail is only written by open(), and its records were checked there
+    auto range = tail.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        RecordHeader record;
+        memcpy(&record, mapped + it->second, sizeof(record));
+        if (record.geometry != geometry || record.target != target) continue;
+        const MoveIndex* moves = mapped + it->second + sizeof(RecordHeader);
+        path.assign(moves, moves + record.length);
+        return true;
+    }
+    auto wanted = make_tuple(key, geometry, (uint64_t)target);
+    const IndexEntry* end = index + indexCount;
+    const IndexEntry* found = lower_bound(index, end, wanted, [](const IndexEntry& e, const tuple<uint64_t, uint64_t, uint64_t>& w) {
+        return make_tuple(e.key, e.geometry, e.target) < w;
+    });
+    if (found == end || make_tuple(found->key, found->geometry, found->target) != wanted) return false;
+    size_t offset = (size_t)found->offset;
+    if (!validRecord(mapped, mappedSize, offset)) return false;
+    RecordHeader record;
+    memcpy(&record, mapped + offset, sizeof(record));
+    if (record.key != key || record.geometry != geometry || record.target != target) return false;
+    const MoveIndex* moves = mapped + offset + sizeof(RecordHeader);
+    path.assign(moves, moves + record.length);
+    return true;
+}
+
+void SolutionStore::insert(uint64_t geometry, int target, uint64_t key, const vector<MoveIndex>& path) {
+    {
+        lock_guard<mutex> lock(logMutex);
+        auto range = inserted.equal_range(key);
+        auto existing = find_if(range.first, range.second, [&](const pair<const uint64_t, LogEntry>& e) {
+            return e.second.geometry == geometry && e.second.target == target;
+        });
+        if (existing != range.second) existing->second.path = path;
+        else inserted.emplace(key, LogEntry{ geometry, target, path });
+    }
+    if (!opened) return;
+    {
+        lock_guard<mutex> lock(writeMutex);
+        writeQueue.push_back(encodeRecord(geometry, target, key, path));
+    }
+    writeReady.notify_one();
+}
+
+void SolutionStore::flush() {
+    unique_lock<mutex> lock(writeMutex);
+    writeDone.wait(lock, [this] { return writeQueue.empty() && !writing; });
+}
+
+size_t SolutionStore::size() const {
+    lock_guard<mutex> lock(logMutex);
+    return indexCount + tail.size() + inserted.size();
+}
+
+void SolutionStore::writerLoop() {
+    FILE* file = nullptr;
+    unique_lock<mutex> lock(writeMutex);
+    while (true) {
+        writeReady.wait(lock, [this] { return stopping || !writeQueue.empty(); });
+        if (writeQueue.empty()) break;
+        deque<vector<uint8_t>> batch;
+        batch.swap(writeQueue);
+        writing = true;
+        lock.unlock();
+        if (!file) file = fopen(filePath.c_str(), "ab");
+        if (file) {
+            for (const auto& record : batch) fwrite(record.data(), 1, record.size(), file);
+            fflush(file);
+        }
+        lock.lock();
+        writing = false;
+        writeDone.notify_all();
+    }
+    if (file) fclose(file);
+}
+
+long long SolutionStore::compact(const string& path) {
+    vector<uint8_t> data;
+    {
+        ifstream in(path, ios::binary);
+        if (in) data.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+
+    // Latest record of each (key, geometry, target) wins; the map order is the index order
+    map<tuple<uint64_t, uint64_t, uint64_t>, vector<MoveIndex>> records;
+    auto collect = [&](size_t offset) {
+        size_t bytes = validRecord(data.data(), data.size(), offset);
+        if (!bytes) return bytes;
+        RecordHeader record;
+        memcpy(&record, data.data() + offset, sizeof(record));
+        const MoveIndex* moves = data.data() + offset + sizeof(RecordHeader);
+        records[make_tuple(record.key, record.geometry, (uint64_t)record.target)].assign(moves, moves + record.length);
+        return bytes;
+    };
+    FileHeader header;
+    size_t offset = sizeof(header);
+    if (!data.empty()) {
+        // The header is only ever written whole, by the rename below, so a file without a valid
+        // one is not a store; the path may name something else and is not overwritten
+        if (data.size() < sizeof(header)) return -1;
+        memcpy(&header, data.data(), sizeof(header));
+        bool valid = memcmp(header.magic, FILE_MAGIC, 8) == 0 && header.version == FILE_VERSION &&
+            header.checksum == checksum(&header, offsetof(FileHeader, checksum)) &&
+            header.indexOffset >= sizeof(header) && header.indexOffset <= data.size() &&
+            header.indexCount <= (data.size() - header.indexOffset) / sizeof(IndexEntry);
+        if (!valid) return -1;
+        for (size_t i = 0; i < header.indexCount; ++i) {
+            IndexEntry entry;
+            memcpy(&entry, data.data() + header.indexOffset + i * sizeof(IndexEntry), sizeof(entry));
+            collect((size_t)entry.offset);
+        }
+        offset = (size_t)(header.indexOffset + header.indexCount * sizeof(IndexEntry));
+    }
+    // Records failing their checksum are dropped; as in open(), the scan resumes at the next byte
+    while (offset + sizeof(RecordHeader) <= data.size()) {
+        size_t bytes = collect(offset);
+        offset += bytes ? bytes : 1;
+    }
+
+    vector<uint8_t> out(sizeof(FileHeader), 0);
+    vector<IndexEntry> entries;
+    for (const auto& record : records) {
+        IndexEntry entry = { get<0>(record.first), get<1>(record.first), get<2>(record.first), out.size() };
+        entries.push_back(entry);
+        vector<uint8_t> bytes = encodeRecord(entry.geometry, (int)entry.target, entry.key, record.second);
+        out.insert(out.end(), bytes.begin(), bytes.end());
+    }
+    FileHeader fresh = {};
+    memcpy(fresh.magic, FILE_MAGIC, 8);
+    fresh.version = FILE_VERSION;
+    fresh.indexOffset = out.size();
+    fresh.indexCount = entries.size();
+    fresh.checksum = checksum(&fresh, offsetof(FileHeader, checksum));
+    memcpy(out.data(), &fresh, sizeof(fresh));
+    const uint8_t* indexBytes = (const uint8_t*)entries.data();
+    out.insert(out.end(), indexBytes, indexBytes + entries.size() * sizeof(IndexEntry));
+
+    // Written beside the store and renamed over it, so a crash leaves either the old or the new file
+    string temporary = path + ".tmp";
+    {
+        ofstream file(temporary, ios::binary | ios::trunc);
+        if (!file.write((const char*)out.data(), out.size()) || !file.flush()) return -1;
+    }
+    error_code error;
+    filesystem::rename(temporary, path, error);
+    if (error) return -1;
+    return (long long)records.size();
+}
@@ -0,0 +1,129 @@
+// solution_store.h
+#ifndef SOLUTION_STORE_H
+#define SOLUTION_STORE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "bitboard.h"
+
+// Solutions kept on disk between runs.
+//
+// File layout (little-endian, all offsets from the start of the file):
+//   FileHeader                      64 bytes
+//   records of the compacted part   each RecordHeader + path bytes, padded to 8
+//   index of the compacted part     IndexEntry[indexCount], sorted by (key, geometry, target)
+//   appended records                same format as above, one per insert since the last compaction
+//
+// The file is memory-mapped when opened. Lookups in the compacted part are a binary
+// search over the mapped index; appended records are found through a table of their
+// offsets in the mapping, built when the file is opened. Every record carries a checksum,
+// so a record torn by a crash, or one another process is still appending, fails it and
+// is skipped; opening never truncates the file, and compact() drops such records. New
+// records are written by a background thread and are visible to find() as soon as
+// insert() returns.
+//
+// A new store is created only where no file (or an empty one) is. A file without a valid
+// header is not a store: it is never written, and the store stays closed (isOpen() false),
+// keeping insert()ed solutions in memory only.
+//
+// Keys are canonical hashes; paths are stored for the canonical representative.
+class SolutionStore {
+public:
+    static const char* const DEFAULT_PATH;
+
+    explicit SolutionStore(const std::string& path = DEFAULT_PATH);
+    ~SolutionStore();
+    SolutionStore(const SolutionStore&) = delete;
+    SolutionStore& operator=(const SolutionStore&) = delete;
+
+    // The process-wide store used by every AISolver unless another one is set
+    static SolutionStore& shared();
+
+    // `geometry` is BoardGeometry::getFingerprint(), `target` the solver's max_pegs_to_solve
+    bool find(std::uint64_t geometry, int target, std::uint64_t key, std::vector<MoveIndex>& path) const;
+    void insert(std::uint64_t geometry, int target, std::uint64_t key, const std::vector<MoveIndex>& path);
+    // Blocks until every inserted record has reached the file
+    void flush();
+
+    std::size_t size() const;
+    bool isOpen() const { return opened; }
+    const std::string& getPath() const { return filePath; }
+
+    // Rewrites `path` with every valid record sorted into the mapped index and duplicates dropped
+    // (the latest record of a key wins); creates an empty store where there is no file. Must not
+    // run while a store has the file open. Returns the number of records kept, -1 if the file
+    // is not a store or could not be written.
+    static long long compact(const std::string& path);
+
+private:
+#pragma pack(push, 1)
+    struct FileHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t reserved;
+        std::uint64_t indexOffset;
+        std::uint64_t indexCount;
+        std::uint64_t checksum;    // of the fields above
+        std::uint8_t padding[24];
+    };
+    struct RecordHeader {
+        std::uint32_t magic;
+        std::uint16_t length;      // moves in the path
+        std::uint8_t target;
+        std::uint8_t reserved;
+        std::uint64_t geometry;
+        std::uint64_t key;
+        std::uint64_t checksum;    // of the fields above and the path bytes
+    };
+    struct IndexEntry {
+        std::uint64_t key;
+        std::uint64_t geometry;
+        std::uint64_t target;
+        std::uint64_t offset;      // of the RecordHeader
+    };
+#pragma pack(pop)
+    struct LogEntry {
+        std::uint64_t geometry;
+        int target;
+        std::vector<MoveIndex> path;
+    };
+
+    std::string filePath;
+    const std::uint8_t* mapped;
+    std::size_t mappedSize;
+    void* mapHandle;               // platform handle kept for unmapping
+    const IndexEntry* index;
+    std::size_t indexCount;
+    bool opened;                   // the file is a store; nothing is written otherwise
+    // Offsets in the mapping of the appended records, the latest of each key, geometry and target
+    std::unordered_multimap<std::uint64_t, std::size_t> tail;
+
+    mutable std::mutex logMutex;
+    std::unordered_multimap<std::uint64_t, LogEntry> inserted; // by this process since it opened the file
+
+    std::mutex writeMutex;
+    std::condition_variable writeReady;
+    std::condition_variable writeDone;
+    std::deque<std::vector<std::uint8_t>> writeQueue;
+    bool writing;
+    bool stopping;
+    std::thread writer;
+
+    void open();
+    void unmap();
+    void writerLoop();
+
+    static std::uint64_t checksum(const void* data, std::size_t bytes, std::uint64_t seed = 0);
+    static std::vector<std::uint8_t> encodeRecord(std::uint64_t geometry, int target, std::uint64_t key, const std::vector<MoveIndex>& path);
+    // Size of the valid record at `offset`, 0 if it is missing, truncated or corrupt
+    static std::size_t validRecord(const std::uint8_t* data, std::size_t size, std::size_t offset);
+};
+
+#endif // SOLUTION_STORE_H
@@ -0,0 +1,96 @@
+#include "symmetry.h"
+#include <climits>
+
+using namespace std;
+
+SymmetryGroup::SymmetryGroup(const BoardGeometry& g) : geometry(g) {
+    int cells = g.getCellCount();
+    byteCount = (cells + 7) / 8;
+    int minX = INT_MAX, minY = INT_MAX;
+    for (int cell = 0; cell < cells; ++cell) {
+        minX = (min)(minX, g.getCellPosition(cell).x);
+        minY = (min)(minY, g.getCellPosition(cell).y);
+    }
+
+    // Linear parts with entries in {-1, 0, 1}; the identity is tried first so it becomes transform 0.
+    // The translation is fixed by the image having the same bounding box as the holes.
+    vector<int> diagonal = { 1, 0, -1 }, offDiagonal = { 0, 1, -1 };
+    for (int a : diagonal) for (int b : offDiagonal) for (int c : offDiagonal) for (int d : diagonal) {
+        int det = a * d - b * c;
+        if (det != 1 && det != -1) continue;
+        int imageMinX = INT_MAX, imageMinY = INT_MAX;
+        for (int cell = 0; cell < cells; ++cell) {
+            Position p = g.getCellPosition(cell);
+            imageMinX = (min)(imageMinX, a * p.x + b * p.y);
+            imageMinY = (min)(imageMinY, c * p.x + d * p.y);
+        }
+        vector<int> image(cells);
+        bool valid = true;
+        for (int cell = 0; cell < cells && valid; ++cell) {
+            Position p = g.getCellPosition(cell);
+            image[cell] = g.getCellIndex(a * p.x + b * p.y + minX - imageMinX, c * p.x + d * p.y + minY - imageMinY);
+            valid = image[cell] >= 0;
+        }
+        if (!valid) continue;
+        vector<MoveIndex> moves(g.getJumpCount());
+        for (int move = 0; move < g.getJumpCount() && valid; ++move) {
+            const Jump& jump = g.getJump((MoveIndex)move);
+            Position from = g.getCellPosition(image[jump.from]);
+            Position to = g.getCellPosition(image[jump.to]);
+            int mapped = g.findJump(from.x, from.y, to.x, to.y);
+            valid = mapped >= 0;
+            if (valid) moves[move] = (MoveIndex)mapped;
+        }
+        if (!valid) continue;
+        bool duplicate = false;
+        for (const auto& existing : cellImages) duplicate = duplicate || existing == image;
+        if (duplicate) continue;
+        cellImages.push_back(image);
+        moveImages.push_back(moves);
+    }
+
+    for (int t = 0; t < size(); ++t) {
+        vector<uint64_t> hashes(g.getJumpCount());
+        for (int move = 0; move < g.getJumpCount(); ++move) hashes[move] = g.getJump(moveImages[t][move]).hash;
+        jumpHashes.push_back(hashes);
+
+        for (int u = 0; u < size(); ++u) {
+            if (cellImages[u][cellImages[t][0]] != 0) continue;
+            bool isInverse = true;
+            for (int cell = 0; cell < cells && isInverse; ++cell) isInverse = cellImages[u][cellImages[t][cell]] == cell;
+            if (isInverse) { inverses.push_back(u); break; }
+        }
+
+        for (int byte = 0; byte < byteCount; ++byte) {
+            for (int value = 0; value < 256; ++value) {
+                BitMask bits = 0;
+                for (int bit = 0; bit < 8; ++bit) {
+                    int cell = byte * 8 + bit;
+                    if ((value >> bit) & 1 && cell < cells) bits |= cellBit(cellImages[t][cell]);
+                }
+                byteTables.push_back(bits);
+            }
+        }
+    }
+}
+
+BitMask SymmetryGroup::apply(int transform, BitMask pegs) const {
+    const BitMask* table = byteTables.data() + (size_t)transform * byteCount * 256;
+    BitMask result = 0;
+    for (int byte = 0; byte < byteCount; ++byte) {
+        result |= table[byte * 256 + ((pegs >> (8 * byte)) & 0xFF)];
+    }
+    return result;
+}
+
+BitMask SymmetryGroup::canonicalize(BitMask pegs, int& transform) const {
+    transform = 0;
+    BitMask best = pegs;
+    uint64_t bestHash = geometry.hashPegs(pegs);
+    for (int t = 1; t < size(); ++t) {
+        BitMask image = apply(t, pegs);
+        uint64_t hash = geometry.hashPegs(image);
+        if (hash < bestHash) { bestHash = hash; best = image; transform = t; }
+    }
+    return best;
+}
@@ -0,0 +1,39 @@
+// symmetry.h
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include <cstdint>
+#include <vector>
+#include "bitboard.h"
+
+// Symmetries of a BoardGeometry: every affine map of the grid that sends holes to holes
+// and jumps to jumps (8 for the cross and the diamond, 6 for the triangle).
+// Transform 0 is the identity.
+//
+// The canonical representative of a position is the image with the smallest Zobrist
+// hash, so BitBoard can find it from its incrementally kept per-transform hashes.
+class SymmetryGroup {
+private:
+    const BoardGeometry& geometry;
+    int byteCount;                               // bytes of a peg mask that hold cells
+    std::vector<std::vector<int>> cellImages;    // [transform][cell]
+    std::vector<std::vector<MoveIndex>> moveImages; // [transform][move]
+    std::vector<std::vector<std::uint64_t>> jumpHashes; // [transform][move]: hash change of the image jump
+    std::vector<int> inverses;
+    std::vector<BitMask> byteTables;             // [transform][byte][value] -> image bits
+
+public:
+    explicit SymmetryGroup(const BoardGeometry& g);
+
+    int size() const { return (int)cellImages.size(); }
+    int cellImage(int transform, int cell) const { return cellImages[transform][cell]; }
+    MoveIndex moveImage(int transform, MoveIndex move) const { return moveImages[transform][move]; }
+    std::uint64_t jumpHash(int transform, MoveIndex move) const { return jumpHashes[transform][move]; }
+    int inverse(int transform) const { return inverses[transform]; }
+
+    BitMask apply(int transform, BitMask pegs) const;
+    // Canonical peg mask of `pegs`; `transform` receives the map from `pegs` to it
+    BitMask canonicalize(BitMask pegs, int& transform) const;
+};
+
+#endif // SYMMETRY_H
@@ -0,0 +1,279 @@
+#include "tablebase.h"
+#include "mapped_file.h"
+#include "symmetry.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+static const char FILE_MAGIC[8] = { 'P', 'E', 'G', 'T', 'A', 'B', 'L', 'E' };
+static const uint32_t FILE_VERSION = 1;
+
+// FNV-1a, as in the solution store
+static uint64_t checksum(const void* data, size_t bytes) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < bytes; ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Next mask with the same number of bits set (Gosper's hack)
+static BitMask nextSubset(BitMask subset) {
+    BitMask low = subset & (~subset + 1), ripple = subset + low;
+    return ripple | (((subset ^ ripple) >> 2) / low);
+}
+
+// Reachable tables key positions by their smallest image; `transform` maps `pegs` onto it
+static BitMask smallestImage(const SymmetryGroup& symmetries, BitMask pegs, int& transform) {
+    BitMask best = pegs;
+    transform = 0;
+    for (int t = 1; t < symmetries.size(); ++t) {
+        BitMask image = symmetries.apply(t, pegs);
+        if (image < best) { best = image; transform = t; }
+    }
+    return best;
+}
+
+static bool canJump(BitMask pegs, const Jump& jump) {
+    return (pegs & jump.mask) == (jump.mask & ~cellBit(jump.to));
+}
+
+Tablebase::Tablebase(const BoardGeometry& g, int t)
+    : geometry(g), target(t), mapped(nullptr), mappedSize(0), mapHandle(nullptr),
+    keys(nullptr), keyCount(0), entries(nullptr), entryCount(0) {
+}
+
+Tablebase::~Tablebase() {
+    unmapFile(mapped, mappedSize, mapHandle);
+}
+
+void Tablebase::adopt(vector<BitMask> newKeys, vector<uint8_t> newEntries) {
+    ownedKeys = move(newKeys);
+    ownedEntries = move(newEntries);
+    keys = ownedKeys.data();
+    keyCount = ownedKeys.size();
+    entries = ownedEntries.data();
+    entryCount = ownedEntries.size();
+}
+
+unique_ptr<Tablebase> Tablebase::buildFull(const BoardGeometry& geometry, int target, const function<bool()>& keepGoing) {
+    int cells = geometry.getCellCount();
+    if (cells > MAX_FULL_CELLS || geometry.getJumpCount() > SOLVED) return nullptr;
+    vector<uint8_t> table((size_t)1 << cells, UNSOLVABLE);
+    size_t settled = 0;
+    // Every child has one peg less, so settling positions in order of peg count finds each child done
+    for (int count = 0; count <= cells; ++count) {
+        for (BitMask pegs = count ? (BitMask(1) << count) - 1 : 0; pegs < table.size(); pegs = nextSubset(pegs)) {
+            if (keepGoing && ++settled % 4096 == 0 && !keepGoing()) return nullptr;
+            uint8_t& entry = table[pegs];
+            if (count <= target) entry = SOLVED;
+            for (int move = 0; move < geometry.getJumpCount() && entry == UNSOLVABLE; ++move) {
+                const Jump& jump = geometry.getJump((MoveIndex)move);
+                if (canJump(pegs, jump) && table[pegs ^ jump.mask] != UNSOLVABLE) entry = (uint8_t)move;
+            }
+            if (count == 0) break;
+        }
+    }
+    unique_ptr<Tablebase> tablebase(new Tablebase(geometry, target));
+    tablebase->adopt({}, move(table));
+    return tablebase;
+}
+
+unique_ptr<Tablebase> Tablebase::buildReachable(const BitBoard& start, int target) {
+    const BoardGeometry& geometry = start.getGeometry();
+    if (geometry.getJumpCount() > SOLVED) return nullptr;
+    const SymmetryGroup& symmetries = geometry.getSymmetries();
+    int transform;
+
+    // One layer per peg count, each sorted
+    vector<vector<BitMask>> layers = { { smallestImage(symmetries, start.getPegs(), transform) } };
+    while (popCount(layers.back().front()) > target) {
+        vector<BitMask> next;
+        for (BitMask pegs : layers.back()) {
+            for (int move = 0; move < geometry.getJumpCount(); ++move) {
+                const Jump& jump = geometry.getJump((MoveIndex)move);
+                if (canJump(pegs, jump)) next.push_back(smallestImage(symmetries, pegs ^ jump.mask, transform));
+            }
+        }
+        if (next.empty()) break;
+        sort(next.begin(), next.end());
+        next.erase(unique(next.begin(), next.end()), next.end());
+        layers.push_back(move(next));
+    }
+
+    vector<vector<uint8_t>> results(layers.size());
+    for (size_t layer = layers.size(); layer-- > 0;) {
+        results[layer].assign(layers[layer].size(), UNSOLVABLE);
+        for (size_t i = 0; i < layers[layer].size(); ++i) {
+            BitMask pegs = layers[layer][i];
+            uint8_t& entry = results[layer][i];
+            if (popCount(pegs) <= target) entry = SOLVED;
+            if (layer + 1 == layers.size()) continue;
+            const vector<BitMask>& children = layers[layer + 1];
+            for (int move = 0; move < geometry.getJumpCount() && entry == UNSOLVABLE; ++move) {
+                const Jump& jump = geometry.getJump((MoveIndex)move);
+                if (!canJump(pegs, jump)) continue;
+                BitMask child = smallestImage(symmetries, pegs ^ jump.mask, transform);
+                size_t index = lower_bound(children.begin(), children.end(), child) - children.begin();
+                if (results[layer + 1][index] != UNSOLVABLE) entry = (uint8_t)move;
+            }
+        }
+    }
+
+    // Layers differ in peg count, so their keys never collide
+    vector<pair<BitMask, uint8_t>> all;
+    for (size_t layer = 0; layer < layers.size(); ++layer) {
+        for (size_t i = 0; i < layers[layer].size(); ++i) all.push_back({ layers[layer][i], results[layer][i] });
+        vector<BitMask>().swap(layers[layer]);
+    }
+    sort(all.begin(), all.end());
+    vector<BitMask> keys(all.size());
+    vector<uint8_t> entries(all.size());
+    for (size_t i = 0; i < all.size(); ++i) {
+        keys[i] = all[i].first;
+        entries[i] = all[i].second;
+    }
+    unique_ptr<Tablebase> tablebase(new Tablebase(geometry, target));
+    tablebase->adopt(move(keys), move(entries));
+    return tablebase;
+}
+
+bool Tablebase::write(const string& path) const {
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FILE_MAGIC, 8);
+    header.version = FILE_VERSION;
+    header.target = (uint32_t)target;
+    header.geometry = geometry.getFingerprint();
+    header.keyCount = keyCount;
+    header.entryCount = entryCount;
+    header.checksum = checksum(&header, offsetof(FileHeader, checksum));
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)keys, (streamsize)(keyCount * sizeof(BitMask)));
+    out.write((const char*)entries, (streamsize)entryCount);
+    return (bool)out.flush();
+}
+
+unique_ptr<Tablebase> Tablebase::open(const string& path, const BoardGeometry& geometry) {
+    size_t size;
+    void* handle;
+    const uint8_t* data = mapFile(path, size, handle);
+    FileHeader header;
+    bool valid = data && size >= sizeof(header);
+    if (valid) {
+        memcpy(&header, data, sizeof(header));
+        size_t cells = (size_t)geometry.getCellCount();
+        valid = memcmp(header.magic, FILE_MAGIC, 8) == 0 && header.version == FILE_VERSION &&
+            header.checksum == checksum(&header, offsetof(FileHeader, checksum)) &&
+            header.geometry == geometry.getFingerprint() &&
+            (header.keyCount ? header.entryCount == header.keyCount : cells <= MAX_FULL_CELLS && header.entryCount == (uint64_t(1) << cells)) &&
+            header.keyCount <= (size - sizeof(header)) / sizeof(BitMask) &&
+            size == sizeof(header) + header.keyCount * sizeof(BitMask) + header.entryCount;
+    }
+    if (!valid) {
+        unmapFile(data, size, handle);
+        return nullptr;
+    }
+    unique_ptr<Tablebase> tablebase(new Tablebase(geometry, (int)header.target));
+    tablebase->mapped = data;
+    tablebase->mappedSize = size;
+    tablebase->mapHandle = handle;
+    tablebase->keys = (const BitMask*)(data + sizeof(header));
+    tablebase->keyCount = (size_t)header.keyCount;
+    tablebase->entries = data + sizeof(header) + tablebase->keyCount * sizeof(BitMask);
+    tablebase->entryCount = (size_t)header.entryCount;
+    return tablebase;
+}
+
+bool Tablebase::lookup(BitMask pegs, uint8_t& entry) const {
+    if (isFull()) {
+        if (pegs >= entryCount) return false;
+        entry = entries[pegs];
+        return true;
+    }
+    const SymmetryGroup& symmetries = geometry.getSymmetries();
+    int transform;
+    BitMask key = smallestImage(symmetries, pegs, transform);
+    const BitMask* found = lower_bound(keys, keys + keyCount, key);
+    if (found == keys + keyCount || *found != key) return false;
+    entry = entries[found - keys];
+    if (entry < SOLVED) entry = symmetries.moveImage(symmetries.inverse(transform), entry);
+    return true;
+}
+
+bool Tablebase::solve(BitMask pegs, vector<MoveIndex>& path) const {
+    path.clear();
+    uint8_t entry;
+    while (lookup(pegs, entry)) {
+        if (entry == SOLVED) return true;
+        if (entry == UNSOLVABLE) break;
+        path.push_back(entry);
+        pegs ^= geometry.getJump(entry).mask;
+    }
+    path.clear();
+    return false;
+}
+
+TablebaseLibrary& TablebaseLibrary::shared() {
+    static TablebaseLibrary library;
+    return library;
+}
+
+bool TablebaseLibrary::load(const string& path, const BoardGeometry& geometry) {
+    unique_ptr<Tablebase> table = Tablebase::open(path, geometry);
+    if (!table) return false;
+    add(move(table));
+    return true;
+}
+
+void TablebaseLibrary::add(unique_ptr<Tablebase> table) {
+    lock_guard<mutex> lock(tablesMutex);
+    tables.push_back(move(table));
+}
+
+void TablebaseLibrary::setAutomaticBuild(bool enabled) {
+    lock_guard<mutex> lock(tablesMutex);
+    automaticBuild = enabled;
+}
+
+const Tablebase* TablebaseLibrary::find(const BoardGeometry& geometry, int target, BitMask pegs) {
+    lock_guard<mutex> lock(tablesMutex);
+    return holding(geometry, target, pegs);
+}
+
+const Tablebase* TablebaseLibrary::holding(const BoardGeometry& geometry, int target, BitMask pegs) const {
+    uint8_t entry;
+    for (const auto& table : tables) {
+        if (table->getGeometry().getFingerprint() == geometry.getFingerprint() && table->getTarget() == target &&
+            table->lookup(pegs, entry)) return table.get();
+    }
+    return nullptr;
+}
+
+bool TablebaseLibrary::hasFullTable(const BoardGeometry& geometry, int target) const {
+    for (const auto& table : tables) {
+        if (table->isFull() && table->getGeometry().getFingerprint() == geometry.getFingerprint() && table->getTarget() == target) return true;
+    }
+    return false;
+}
+
+const Tablebase* TablebaseLibrary::findOrBuild(const BoardGeometry& geometry, int target, BitMask pegs, const function<bool()>& keepGoing) {
+    {
+        lock_guard<mutex> lock(tablesMutex);
+        if (const Tablebase* table = holding(geometry, target, pegs)) return table;
+        // A full table of this geometry that does not hold `pegs`: not a position of it
+        if (!automaticBuild || geometry.getCellCount() > Tablebase::MAX_FULL_CELLS || hasFullTable(geometry, target)) return nullptr;
+    }
+    unique_ptr<Tablebase> table = Tablebase::buildFull(geometry, target, keepGoing);
+    uint8_t entry;
+    if (!table || !table->lookup(pegs, entry)) return nullptr;
+    lock_guard<mutex> lock(tablesMutex);
+    // Another thread may have built the same table meanwhile; the first one is kept
+    if (!hasFullTable(geometry, target)) tables.push_back(move(table));
+    return holding(geometry, target, pegs);
+}
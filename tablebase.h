@@ -0,0 +1,115 @@
+// tablebase.h
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "bitboard.h"
+
+// Solvability of every position of a small set, together with the first move of a solution.
+//
+// One byte per position: the MoveIndex of a winning jump, SOLVED (no more than `target` pegs
+// left) or UNSOLVABLE. Every jump removes one peg, so all solutions of a position are equally
+// long and any winning first move is a best one. Two kinds of table:
+//   full       every peg mask of a geometry with at most MAX_FULL_CELLS holes, indexed by the
+//              mask itself (32 KB for the triangle)
+//   reachable  the positions reachable from one start, such as a level: sorted canonical peg
+//              masks and one byte each, the move given for the canonical representative
+//
+// File layout (little-endian): FileHeader (64 bytes), keys (keyCount BitMasks, none for a full
+// table), entries (one byte per key, or 2^cells for a full table). Files are memory-mapped.
+class Tablebase {
+public:
+    static constexpr std::uint8_t SOLVED = 0xFE;
+    static constexpr std::uint8_t UNSOLVABLE = 0xFF;
+    static constexpr int MAX_FULL_CELLS = 24;
+
+    // Retrograde pass over every position; nullptr if the geometry has too many holes, or once
+    // `keepGoing`, asked every few thousand positions, returns false
+    static std::unique_ptr<Tablebase> buildFull(const BoardGeometry& geometry, int target,
+        const std::function<bool()>& keepGoing = nullptr);
+    // Forward pass collecting the positions reachable from `start`, then a retrograde pass over them
+    static std::unique_ptr<Tablebase> buildReachable(const BitBoard& start, int target);
+    // nullptr if the file is missing, damaged or holds a table of another geometry
+    static std::unique_ptr<Tablebase> open(const std::string& path, const BoardGeometry& geometry);
+    bool write(const std::string& path) const;
+
+    ~Tablebase();
+    Tablebase(const Tablebase&) = delete;
+    Tablebase& operator=(const Tablebase&) = delete;
+
+    const BoardGeometry& getGeometry() const { return geometry; }
+    int getTarget() const { return target; }
+    bool isFull() const { return keyCount == 0; }
+    // Positions held, symmetric ones once in a reachable table
+    std::size_t size() const { return isFull() ? entryCount : keyCount; }
+
+    // Entry of `pegs` with the move seen from `pegs` itself; false if the table does not hold it
+    bool lookup(BitMask pegs, std::uint8_t& entry) const;
+    // Follows the table to a finishing position; false if `pegs` is not held or unsolvable
+    bool solve(BitMask pegs, std::vector<MoveIndex>& path) const;
+
+private:
+#pragma pack(push, 1)
+    struct FileHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t target;
+        std::uint64_t geometry;    // BoardGeometry::getFingerprint()
+        std::uint64_t keyCount;
+        std::uint64_t entryCount;
+        std::uint64_t checksum;    // of the fields above
+        std::uint8_t padding[16];
+    };
+#pragma pack(pop)
+
+    const BoardGeometry& geometry;
+    int target;
+    std::vector<BitMask> ownedKeys;        // a built table owns its data,
+    std::vector<std::uint8_t> ownedEntries;
+    const std::uint8_t* mapped;            // an opened one maps it
+    std::size_t mappedSize;
+    void* mapHandle;
+    const BitMask* keys;
+    std::size_t keyCount;
+    const std::uint8_t* entries;
+    std::size_t entryCount;
+
+    Tablebase(const BoardGeometry& geometry, int target);
+    void adopt(std::vector<BitMask> keys, std::vector<std::uint8_t> entries);
+};
+
+// Tables consulted by AISolver::findSolution. Full tables of small geometries are built by
+// findOrBuild the first time a position of theirs is asked for; others are added from pegtable files.
+class TablebaseLibrary {
+public:
+    static TablebaseLibrary& shared();
+
+    // Adds the table of a file; false if it cannot be opened
+    bool load(const std::string& path, const BoardGeometry& geometry);
+    void add(std::unique_ptr<Tablebase> table);
+    // A table of `geometry` and `target` that holds `pegs`, nullptr if there is none
+    const Tablebase* find(const BoardGeometry& geometry, int target, BitMask pegs);
+    // As find, but builds the full table of a small geometry that has none. The build runs
+    // outside the lock and is dropped once `keepGoing` returns false.
+    const Tablebase* findOrBuild(const BoardGeometry& geometry, int target, BitMask pegs,
+        const std::function<bool()>& keepGoing = nullptr);
+    // When off, findOrBuild only returns tables that were added
+    void setAutomaticBuild(bool enabled);
+
+private:
+    std::mutex tablesMutex;
+    std::vector<std::unique_ptr<Tablebase>> tables;
+    bool automaticBuild = true;
+
+    // Callers hold tablesMutex
+    const Tablebase* holding(const BoardGeometry& geometry, int target, BitMask pegs) const;
+    bool hasFullTable(const BoardGeometry& geometry, int target) const;
+};
+
+#endif // TABLEBASE_H
@@ -0,0 +1,91 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+using namespace std;
+
+// Pool and index of the worker running on this thread
+static thread_local const WorkStealingPool* current_pool = nullptr;
+static thread_local int current_index = -1;
+
+void WorkStealingPool::TaskGroup::wait() {
+    unique_lock<mutex> lock(doneMutex);
+    done.wait(lock, [this] { return pending == 0; });
+}
+
+WorkStealingPool::WorkStealingPool(int threadCount) : stopping(false), queued(0), nextInjection(0) {
+    if (threadCount <= 0) threadCount = (std::max)(1u, thread::hardware_concurrency());
+    for (int i = 0; i < threadCount; ++i) workers.push_back(make_unique<Worker>());
+    for (int i = 0; i < threadCount; ++i) threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        lock_guard<mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads) t.join();
+}
+
+int WorkStealingPool::currentWorkerIndex() const {
+    return current_pool == this ? current_index : -1;
+}
+
+void WorkStealingPool::submit(TaskGroup& group, Task task) {
+    {
+        lock_guard<mutex> lock(group.doneMutex);
+        group.pending++;
+    }
+    // The count drops under the group's lock so wait() cannot return (and the group
+    // cannot be destroyed) before this task has let go of it
+    Task wrapped = [&group, task]() {
+        task();
+        lock_guard<mutex> lock(group.doneMutex);
+        if (--group.pending == 0) group.done.notify_all();
+    };
+    int index = currentWorkerIndex();
+    if (index < 0) index = (int)(nextInjection++ % workers.size());
+    {
+        lock_guard<mutex> lock(workers[index]->mutex);
+        workers[index]->tasks.push_back(move(wrapped));
+    }
+    queued++;
+    {
+        lock_guard<mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+bool WorkStealingPool::tryRun(int index) {
+    Task task;
+    {
+        Worker& own = *workers[index];
+        lock_guard<mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+    for (size_t offset = 1; !task && offset < workers.size(); ++offset) {
+        Worker& victim = *workers[(index + offset) % workers.size()];
+        lock_guard<mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+    if (!task) return false;
+    queued--;
+    task();
+    return true;
+}
+
+void WorkStealingPool::workerLoop(int index) {
+    current_pool = this;
+    current_index = index;
+    while (!stopping.load()) {
+        if (tryRun(index)) continue;
+        unique_lock<mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping.load() || queued.load() > 0; });
+    }
+}
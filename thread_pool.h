@@ -0,0 +1,62 @@
+// thread_pool.h
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads with one task deque each.
+// A worker pushes and pops the back of its own deque (depth-first, cache friendly);
+// idle workers steal from the front of the others, which holds the oldest and
+// therefore largest pending subtrees.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    // Counts the outstanding tasks of one batch
+    class TaskGroup {
+        friend class WorkStealingPool;
+        int pending = 0;
+        std::mutex doneMutex;
+        std::condition_variable done;
+    public:
+        // Blocks until every task submitted to this group has finished
+        void wait();
+    };
+
+    // threadCount <= 0 uses std::thread::hardware_concurrency()
+    explicit WorkStealingPool(int threadCount = 0);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int getThreadCount() const { return (int)threads.size(); }
+    // Called from a worker the task goes to that worker's deque, otherwise round-robin
+    void submit(TaskGroup& group, Task task);
+    // Index of the calling worker thread, -1 when called from outside the pool
+    int currentWorkerIndex() const;
+
+private:
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopping;
+    std::atomic<int> queued;
+    std::atomic<unsigned> nextInjection;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+
+    void workerLoop(int index);
+    bool tryRun(int index);
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,128 @@
+#include "transposition_table.h"
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <thread>
+
+using namespace std;
+
+// Layout of Entry::data
+static const uint64_t OCCUPIED = 1ULL << 63;
+static inline uint64_t packData(int remainingBound, int geometryId, int target, int depth, int workLog = 0) {
+    return OCCUPIED | (uint64_t)(remainingBound & 0xFFFF) | ((uint64_t)(geometryId & 0xFF) << 16) |
+        ((uint64_t)(target & 0xFF) << 24) | ((uint64_t)(depth & 0xFF) << 32) | ((uint64_t)(workLog & 0xFF) << 40);
+}
+static inline int boundOf(uint64_t data) { return (int)(data & 0xFFFF); }
+// What evicting the entry costs: log2 of the work below it, then its peg count
+static inline int valueOf(uint64_t data) { return (int)((data >> 32) & 0xFFFF); }
+static inline uint64_t ownerOf(uint64_t data) { return data & 0xFFFF0000ULL; } // geometry id + target
+
+TranspositionTable::TranspositionTable(size_t megabytes) : verify(false) {
+    size_t count = 1;
+    while (count * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024) count *= 2;
+    buckets.reset(new Bucket[count]);
+    bucketMask = count - 1;
+    clear();
+}
+
+TranspositionTable& TranspositionTable::shared() {
+    static TranspositionTable table;
+    return table;
+}
+
+TranspositionTable::CounterShard& TranspositionTable::localCounters() {
+    static thread_local size_t shard = hash<thread::id>()(this_thread::get_id()) % COUNTER_SHARDS;
+    return counters[shard];
+}
+
+uint64_t TranspositionTable::tagOf(const BitBoard& board) const {
+    return verify.load(memory_order_relaxed) ? board.getCanonicalPegs() : board.getCanonicalHash();
+}
+
+bool TranspositionTable::probe(const BitBoard& board, int target, int& remainingBound) {
+    CounterShard& stats = localCounters();
+    stats.probes.fetch_add(1, memory_order_relaxed);
+    uint64_t key = board.getCanonicalHash();
+    uint64_t tag = tagOf(board);
+    uint64_t owner = ownerOf(packData(0, board.getGeometry().getId(), target, 0));
+    Bucket& bucket = buckets[key & bucketMask];
+    for (Entry& entry : bucket.entries) {
+        uint64_t data = entry.data.load(memory_order_relaxed);
+        uint64_t check = entry.check.load(memory_order_relaxed);
+        if (!(data & OCCUPIED) || ownerOf(data) != owner) continue;
+        if ((check ^ data) == tag) {
+            stats.hits.fetch_add(1, memory_order_relaxed);
+            int bound = boundOf(data);
+            remainingBound = bound == UNSOLVABLE ? INT_MAX : bound;
+            return true;
+        }
+        if (verify.load(memory_order_relaxed) && board.getGeometry().hashPegs(check ^ data) == key) {
+            stats.collisions.fetch_add(1, memory_order_relaxed);
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(const BitBoard& board, int target, int remainingBound, long long work) {
+    CounterShard& stats = localCounters();
+    stats.stores.fetch_add(1, memory_order_relaxed);
+    uint64_t tag = tagOf(board);
+    int bound = remainingBound >= UNSOLVABLE ? UNSOLVABLE : remainingBound;
+    int workLog = 0;
+    while (workLog < 62 && (work >> (workLog + 1)) > 0) ++workLog;
+    uint64_t data = packData(bound, board.getGeometry().getId(), target, board.getPegCount(), workLog);
+    Bucket& bucket = buckets[board.getCanonicalHash() & bucketMask];
+
+    // Same position first, then an empty slot, otherwise evict the cheapest subtree
+    Entry* victim = nullptr;
+    int victimValue = INT_MAX;
+    for (Entry& entry : bucket.entries) {
+        uint64_t old = entry.data.load(memory_order_relaxed);
+        if (!(old & OCCUPIED)) {
+            if (victimValue >= 0) { victim = &entry; victimValue = -1; }
+            continue;
+        }
+        if (ownerOf(old) == ownerOf(data) && (entry.check.load(memory_order_relaxed) ^ old) == tag) {
+            victim = &entry;
+            victimValue = -2;
+            break;
+        }
+        if (valueOf(old) < victimValue) { victim = &entry; victimValue = valueOf(old); }
+    }
+    if (victimValue >= 0) stats.replacements.fetch_add(1, memory_order_relaxed);
+    else if (victimValue == -1) stats.fills.fetch_add(1, memory_order_relaxed);
+    victim->check.store(tag ^ data, memory_order_relaxed);
+    victim->data.store(data, memory_order_relaxed);
+}
+
+void TranspositionTable::setVerification(bool enabled) {
+    if (verify.exchange(enabled) != enabled) clear();
+}
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; i <= bucketMask; ++i) {
+        for (Entry& entry : buckets[i].entries) {
+            entry.check.store(0, memory_order_relaxed);
+            entry.data.store(0, memory_order_relaxed);
+        }
+    }
+    for (CounterShard& shard : counters) shard.fills.store(0, memory_order_relaxed);
+}
+
+TranspositionTable::Statistics TranspositionTable::getStatistics() const {
+    Statistics result;
+    for (const CounterShard& shard : counters) {
+        result.probes += shard.probes.load(memory_order_relaxed);
+        result.hits += shard.hits.load(memory_order_relaxed);
+        result.stores += shard.stores.load(memory_order_relaxed);
+        result.replacements += shard.replacements.load(memory_order_relaxed);
+        result.collisions += shard.collisions.load(memory_order_relaxed);
+        result.used += (size_t)shard.fills.load(memory_order_relaxed);
+    }
+    result.buckets = bucketMask + 1;
+    result.bytes = result.buckets * sizeof(Bucket);
+    result.entries = result.buckets * BUCKET_ENTRIES;
+    // Two threads filling the same empty slot at once both count it
+    result.used = (std::min)(result.used, result.entries);
+    return result;
+}
@@ -0,0 +1,75 @@
+// transposition_table.h
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "bitboard.h"
+
+// Fixed-size transposition table shared by every solver thread.
+// Each bucket is one cache line of four entries. Entries are two atomic words written
+// without locks as (tag ^ data, data): a torn read fails the tag check and is a miss.
+// The table never grows: a store into a full bucket evicts the entry whose subtree took
+// the least work to search, ties going to the one with fewer pegs.
+// Stored bounds are remaining cost from the position, so they stay valid across
+// IDA* iterations, root tasks and solves of different starting positions.
+// Positions are looked up by their canonical form, so one entry serves a whole symmetry class.
+class TranspositionTable {
+public:
+    static const int UNSOLVABLE = 0xFFFF; // remaining bound meaning "no solution below this position"
+
+    struct Statistics {
+        long long probes = 0;
+        long long hits = 0;
+        long long stores = 0;
+        long long replacements = 0; // a live entry of another position was evicted
+        long long collisions = 0;   // verification mode: same hash, different pegs
+        std::size_t buckets = 0;
+        std::size_t bytes = 0;
+        std::size_t entries = 0;    // capacity
+        std::size_t used = 0;       // entries holding a position
+    };
+
+    explicit TranspositionTable(std::size_t megabytes = 32);
+
+    // The process-wide table used by every AISolver unless another one is set
+    static TranspositionTable& shared();
+
+    // `target` is the solver's max_pegs_to_solve; entries only match the same target and geometry
+    bool probe(const BitBoard& board, int target, int& remainingBound);
+    // `work` is the number of nodes the search expanded below the position
+    void store(const BitBoard& board, int target, int remainingBound, long long work = 1);
+
+    // Verification mode tags entries with the full canonical peg mask instead of the hash.
+    // Switching modes clears the table.
+    void setVerification(bool enabled);
+    bool isVerifying() const { return verify.load(std::memory_order_relaxed); }
+    void clear();
+    Statistics getStatistics() const;
+
+private:
+    struct Entry {
+        std::atomic<std::uint64_t> check; // tag ^ data
+        std::atomic<std::uint64_t> data;
+    };
+    static const int BUCKET_ENTRIES = 4;
+    struct alignas(64) Bucket {
+        Entry entries[BUCKET_ENTRIES];
+    };
+    struct alignas(64) CounterShard {
+        std::atomic<long long> probes{ 0 }, hits{ 0 }, stores{ 0 }, replacements{ 0 }, collisions{ 0 }, fills{ 0 };
+    };
+    static const int COUNTER_SHARDS = 16;
+
+    std::unique_ptr<Bucket[]> buckets;
+    std::size_t bucketMask;
+    std::atomic<bool> verify;
+    CounterShard counters[COUNTER_SHARDS];
+
+    CounterShard& localCounters();
+    std::uint64_t tagOf(const BitBoard& board) const;
+};
+
+#endif // TRANSPOSITION_TABLE_H